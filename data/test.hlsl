@@ -6,7 +6,6 @@ struct Vertex {
 };
 
 StructuredBuffer<Vertex> vbuffer : register(t0, space0);
-StructuredBuffer<uint> ibuffer : register(t1, space0);
 
 cbuffer Camera : register(b0, space0) {
     matrix vp;
@@ -18,7 +17,7 @@ struct VSOut {
 };
 
 VSOut vs_main(uint vertex_id : SV_VertexID) {
-    Vertex vertex = vbuffer[ibuffer[vertex_id]];
+    Vertex vertex = vbuffer[vertex_id];
 
     VSOut vso;
     vso.sv_pos = mul(vp, float4(vertex.pos, 1.0f));
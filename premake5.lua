@@ -23,6 +23,13 @@ project "deez"
         "src/**.cpp",
     }
 
+    removefiles {
+        "src/platform_posix.cpp",
+        "src/headless.cpp",
+        "src/cook.cpp",
+        "src/renderer_soft.cpp",
+    }
+
     includedirs {
         "src",
     }
@@ -39,4 +46,105 @@ project "deez"
 
     filter "configurations:Release"
         defines { "NDEBUG" }
-        optimize "On"
\ No newline at end of file
+        optimize "On"
+
+-- Runs the asset pipeline without a window or GPU, for profiling on any platform.
+project "deez_headless"
+    kind "ConsoleApp"
+    language "C++"
+
+    targetdir "target/bin/%{prj.name}/%{cfg.buildcfg}"
+    objdir "target/obj/%{prj.name}/%{cfg.buildcfg}"
+    debugdir "data"
+
+    warnings "Extra"
+    flags { "FatalWarnings" }
+
+    files {
+        "src/common.h",
+        "src/platform.h",
+        "src/renderer.h",
+        "src/arena.*",
+        "src/json.*",
+        "src/base64.*",
+        "src/gltf.*",
+        "src/jobs.*",
+        "src/mesh_blob.*",
+        "src/hash.*",
+        "src/mesh_opt.*",
+        "src/mesh_pool.*",
+        "src/descriptor_alloc.*",
+        "src/buffer_heap.*",
+        "src/upload_ring.*",
+        "src/renderer_soft.*",
+        "src/headless.cpp",
+    }
+
+    includedirs {
+        "src",
+    }
+
+    filter "system:windows"
+        disablewarnings { "4505" }
+        files { "src/platform_win32.cpp" }
+
+    filter "system:not windows"
+        files { "src/platform_posix.cpp" }
+        links { "pthread", "m" }
+        disablewarnings { "switch", "write-strings" }
+
+    filter "configurations:Debug"
+        defines { "_DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "On"
+
+-- Cooks glTF assets into the mapped mesh format read by mesh_blob_open.
+project "deez_cook"
+    kind "ConsoleApp"
+    language "C++"
+
+    targetdir "target/bin/%{prj.name}/%{cfg.buildcfg}"
+    objdir "target/obj/%{prj.name}/%{cfg.buildcfg}"
+    debugdir "data"
+
+    warnings "Extra"
+    flags { "FatalWarnings" }
+
+    files {
+        "src/common.h",
+        "src/platform.h",
+        "src/renderer.h",
+        "src/arena.*",
+        "src/json.*",
+        "src/base64.*",
+        "src/gltf.*",
+        "src/jobs.*",
+        "src/mesh_blob.*",
+        "src/hash.*",
+        "src/mesh_opt.*",
+        "src/cook.cpp",
+    }
+
+    includedirs {
+        "src",
+    }
+
+    filter "system:windows"
+        disablewarnings { "4505" }
+        files { "src/platform_win32.cpp" }
+
+    filter "system:not windows"
+        files { "src/platform_posix.cpp" }
+        links { "pthread", "m" }
+        disablewarnings { "switch", "write-strings" }
+
+    filter "configurations:Debug"
+        defines { "_DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "On"
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_MAX_BLOCK_SIZE (64 * 1024 * 1024)
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    size_t cap;
+    size_t used;
+};
+
+static size_t align_up(size_t x, size_t a) {
+    return (x + a - 1) & ~(a - 1);
+}
+
+static size_t block_header_size() {
+    return align_up(sizeof(ArenaBlock), ARENA_ALIGN);
+}
+
+void arena_init(Arena* a, size_t block_size) {
+    memset(a, 0, sizeof(*a));
+    a->block_size = block_size;
+}
+
+void arena_free(Arena* a) {
+    for (ArenaBlock* b = a->block; b;) {
+        ArenaBlock* prev = b->prev;
+        free(b);
+        b = prev;
+    }
+
+    a->block = NULL;
+    a->block_count = 0;
+}
+
+void arena_absorb(Arena* a, Arena* other) {
+    if (!other->block) {
+        return;
+    }
+
+    ArenaBlock* tail = other->block;
+    while (tail->prev) {
+        tail = tail->prev;
+    }
+
+    // Keep a's current block at the head, so later pushes continue filling it.
+    if (a->block) {
+        tail->prev = a->block->prev;
+        a->block->prev = other->block;
+    }
+    else {
+        a->block = other->block;
+    }
+
+    a->block_count += other->block_count;
+
+    other->block = NULL;
+    other->block_count = 0;
+}
+
+void* arena_push(Arena* a, size_t size) {
+    size = align_up(size, ARENA_ALIGN);
+
+    ArenaBlock* b = a->block;
+
+    if (!b || b->used + size > b->cap) {
+        size_t cap = a->block_size;
+        if (cap < size) {
+            cap = size;
+        }
+
+        // Blocks come from calloc, and memory is never handed out twice, so pushes are always zeroed.
+        b = (ArenaBlock*)calloc(1, block_header_size() + cap);
+        assert(b && "out of memory");
+        b->prev = a->block;
+        b->cap = cap;
+
+        a->block = b;
+        ++a->block_count;
+
+        if (a->block_size < ARENA_MAX_BLOCK_SIZE) {
+            a->block_size *= 2;
+        }
+    }
+
+    void* ptr = (char*)b + block_header_size() + b->used;
+    b->used += size;
+
+    return ptr;
+}
+
+char* arena_push_string(Arena* a, char* str, size_t len) {
+    char* s = (char*)arena_push(a, len + 1);
+    memcpy(s, str, len);
+    s[len] = '\0';
+    return s;
+}
+
+void arena_stats(Arena* a, ArenaStats* o_stats) {
+    memset(o_stats, 0, sizeof(ArenaStats));
+
+    for (ArenaBlock* b = a->block; b; b = b->prev) {
+        o_stats->block_count++;
+        o_stats->reserved += b->cap;
+        o_stats->used += b->used;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common.h"
+
+struct ArenaBlock;
+
+struct Arena {
+    ArenaBlock* block;
+    size_t block_size;
+    int block_count;
+};
+
+struct ArenaStats {
+    int block_count;
+    size_t reserved; // Bytes in all blocks, excluding headers.
+    size_t used; // Bytes pushed, after alignment.
+};
+
+void arena_init(Arena* a, size_t block_size);
+void arena_free(Arena* a);
+
+// Moves all of other's blocks into a, so they are released with it.
+void arena_absorb(Arena* a, Arena* other);
+
+void* arena_push(Arena* a, size_t size);
+char* arena_push_string(Arena* a, char* str, size_t len);
+
+void arena_stats(Arena* a, ArenaStats* o_stats);
+
+#define ARENA_PUSH_STRUCT(a, type) ((type*)arena_push(a, sizeof(type)))
+#define ARENA_PUSH_ARRAY(a, type, count) ((type*)arena_push(a, (count) * sizeof(type)))
@@ -0,0 +1,285 @@
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define BASE64_TARGET(x)
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BASE64_TARGET(x) __attribute__((target(x)))
+#endif
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__i386__)
+#define BASE64_X86 1
+#endif
+
+#include "base64.h"
+
+static const int8_t decode_table[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+size_t base64_decoded_size(char* in, size_t len) {
+    if (len < 4 || len % 4 != 0) {
+        return 0;
+    }
+
+    size_t size = len / 4 * 3;
+
+    if (in[len - 1] == '=') {
+        --size;
+    }
+    if (in[len - 2] == '=') {
+        --size;
+    }
+
+    return size;
+}
+
+// Decodes whole quanta without padding; returns false on any character outside the alphabet.
+static bool decode_scalar(char* in, size_t len, uint8_t* out) {
+    for (size_t i = 0; i < len; i += 4, out += 3) {
+        int a = decode_table[(uint8_t)in[i]];
+        int b = decode_table[(uint8_t)in[i + 1]];
+        int c = decode_table[(uint8_t)in[i + 2]];
+        int d = decode_table[(uint8_t)in[i + 3]];
+
+        if ((a | b | c | d) < 0) {
+            return false;
+        }
+
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = (uint8_t)(v >> 16);
+        out[1] = (uint8_t)(v >> 8);
+        out[2] = (uint8_t)v;
+    }
+
+    return true;
+}
+
+#if BASE64_X86
+
+// Vector paths classify and translate characters with nibble lookups (pshufb), then pack
+// 4x6 bits into 3 bytes with multiply-adds. See Muła & Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions".
+// Each step stores a full register, so callers leave that much slack at the end of the output.
+
+BASE64_TARGET("ssse3")
+static size_t decode_ssse3(char* in, size_t len, uint8_t* out, size_t out_max, bool* o_valid) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    size_t j = 0;
+
+    for (; i + 16 <= len && j + 16 <= out_max; i += 16, j += 12) {
+        __m128i str = _mm_loadu_si128((const __m128i*)(in + i));
+
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+            *o_valid = false;
+            return i;
+        }
+
+        __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        str = _mm_add_epi8(str, roll);
+
+        __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*)(out + j), _mm_shuffle_epi8(merged, pack));
+    }
+
+    return i;
+}
+
+BASE64_TARGET("avx2")
+static size_t decode_avx2(char* in, size_t len, uint8_t* out, size_t out_max, bool* o_valid) {
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    size_t i = 0;
+    size_t j = 0;
+
+    for (; i + 32 <= len && j + 32 <= out_max; i += 32, j += 24) {
+        __m256i str = _mm256_loadu_si256((const __m256i*)(in + i));
+
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+
+        if (!_mm256_testz_si256(lo, hi)) {
+            *o_valid = false;
+            return i;
+        }
+
+        __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        _mm256_storeu_si256((__m256i*)(out + j), _mm256_permutevar8x32_epi32(merged, gather));
+    }
+
+    return i;
+}
+
+enum Base64Impl {
+    BASE64_IMPL_UNKNOWN,
+    BASE64_IMPL_SCALAR,
+    BASE64_IMPL_SSSE3,
+    BASE64_IMPL_AVX2,
+};
+
+static Base64Impl detect_impl() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool ymm_enabled = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = ymm_enabled && (info[1] & (1 << 5)) != 0;
+#else
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (avx2) {
+        return BASE64_IMPL_AVX2;
+    }
+    if (ssse3) {
+        return BASE64_IMPL_SSSE3;
+    }
+    return BASE64_IMPL_SCALAR;
+}
+
+// Loader jobs can race on the first decode. Detection gives every thread the same answer,
+// so the atomics only need to make the shared store well defined.
+static volatile uint32_t detected_impl = BASE64_IMPL_UNKNOWN;
+
+static size_t decode_vector(char* in, size_t len, uint8_t* out, size_t out_max, bool* o_valid) {
+    uint32_t impl = atomic_load32(&detected_impl);
+    if (impl == BASE64_IMPL_UNKNOWN) {
+        impl = detect_impl();
+        atomic_store32(&detected_impl, impl);
+    }
+
+    switch (impl) {
+        case BASE64_IMPL_AVX2:
+            return decode_avx2(in, len, out, out_max, o_valid);
+        case BASE64_IMPL_SSSE3:
+            return decode_ssse3(in, len, out, out_max, o_valid);
+        default:
+            return 0;
+    }
+}
+
+#else
+
+static size_t decode_vector(char* in, size_t len, uint8_t* out, size_t out_max, bool* o_valid) {
+    UNUSED(in);
+    UNUSED(len);
+    UNUSED(out);
+    UNUSED(out_max);
+    UNUSED(o_valid);
+    return 0;
+}
+
+#endif
+
+static bool decode(char* in, size_t len, void* out, size_t out_max, size_t* o_len, bool vector) {
+    size_t size = base64_decoded_size(in, len);
+    if (len != 0 && size == 0) {
+        return false;
+    }
+    if (size > out_max) {
+        return false;
+    }
+
+    uint8_t* dst = (uint8_t*)out;
+
+    // The final quantum may carry padding, so it always goes through the scalar tail.
+    size_t body_len = len ? len - 4 : 0;
+
+    bool valid = true;
+    size_t done = vector ? decode_vector(in, body_len, dst, out_max, &valid) : 0;
+    if (!valid) {
+        return false;
+    }
+
+    if (!decode_scalar(in + done, body_len - done, dst + done / 4 * 3)) {
+        return false;
+    }
+
+    if (len) {
+        char* last = in + body_len;
+
+        char quantum[4];
+        memcpy(quantum, last, 4);
+
+        int padding = (quantum[3] == '=') + (quantum[2] == '=' && quantum[3] == '=');
+        if (quantum[2] == '=' && quantum[3] != '=') {
+            return false;
+        }
+
+        for (int i = 4 - padding; i < 4; ++i) {
+            quantum[i] = 'A';
+        }
+
+        uint8_t bytes[3];
+        if (!decode_scalar(quantum, 4, bytes)) {
+            return false;
+        }
+
+        memcpy(dst + body_len / 4 * 3, bytes, 3 - padding);
+    }
+
+    if (o_len) {
+        *o_len = size;
+    }
+
+    return true;
+}
+
+bool base64_decode(char* in, size_t len, void* out, size_t out_max, size_t* o_len) {
+    return decode(in, len, out, out_max, o_len, true);
+}
+
+bool base64_decode_scalar(char* in, size_t len, void* out, size_t out_max, size_t* o_len) {
+    return decode(in, len, out, out_max, o_len, false);
+}
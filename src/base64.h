@@ -0,0 +1,13 @@
+#pragma once
+
+#include "common.h"
+
+// Decoded byte count of a base64 string of len characters, accounting for padding. 0 if len isn't a multiple of 4.
+size_t base64_decoded_size(char* in, size_t len);
+
+// Decodes len characters of standard, padded base64. Uses AVX2 or SSSE3 when the CPU has them.
+// Returns false if the input is malformed or doesn't fit in out_max bytes.
+bool base64_decode(char* in, size_t len, void* out, size_t out_max, size_t* o_len);
+
+// The same decoder without the vector paths, as a reference for tests and benchmarks.
+bool base64_decode_scalar(char* in, size_t len, void* out, size_t out_max, size_t* o_len);
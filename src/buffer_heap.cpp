@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer_heap.h"
+
+#define SL_BITS 3
+#define SL_COUNT (1 << SL_BITS)
+#define FL_COUNT 32
+
+#define NODE_NONE UINT32_MAX
+
+// A range of a block, free or allocated. Physical links join neighbouring ranges in the same block,
+// bin links join free ranges of the same size class.
+struct HeapNode {
+    uint32_t block;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t phys_prev;
+    uint32_t phys_next;
+    uint32_t bin_prev;
+    uint32_t bin_next;
+    bool free;
+};
+
+struct BufferHeap {
+    uint32_t block_size;
+    BufferHeapBlockProc* create_block;
+    void* user;
+
+    HeapNode* nodes;
+    uint32_t node_count;
+    uint32_t node_cap;
+
+    uint32_t* unused_nodes;
+    uint32_t unused_count;
+
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmaps[FL_COUNT];
+    uint32_t bins[FL_COUNT][SL_COUNT];
+
+    uint32_t block_count;
+    uint32_t alloc_count;
+    uint32_t free_range_count;
+    uint64_t reserved;
+    uint64_t used;
+    uint64_t peak_used;
+};
+
+#define ROUND_GRANULE(x) (((x) + BUFFER_HEAP_GRANULE - 1) & ~(uint32_t)(BUFFER_HEAP_GRANULE - 1))
+
+// Sizes below SL_COUNT granules get a bin each; above that, each power of two splits into SL_COUNT bins.
+static void bin_for(uint32_t size, uint32_t* fl, uint32_t* sl) {
+    uint32_t units = size / BUFFER_HEAP_GRANULE;
+
+    if (units < SL_COUNT) {
+        *fl = 0;
+        *sl = units;
+    }
+    else {
+        uint32_t msb = msb32(units);
+        *fl = msb - SL_BITS + 1;
+        *sl = (units >> (msb - SL_BITS)) - SL_COUNT;
+    }
+}
+
+static uint32_t new_node(BufferHeap* heap) {
+    if (heap->unused_count > 0) {
+        return heap->unused_nodes[--heap->unused_count];
+    }
+
+    if (heap->node_count == heap->node_cap) {
+        heap->node_cap = heap->node_cap ? heap->node_cap * 2 : 256;
+        heap->nodes = (HeapNode*)realloc(heap->nodes, heap->node_cap * sizeof(HeapNode));
+        heap->unused_nodes = (uint32_t*)realloc(heap->unused_nodes, heap->node_cap * sizeof(uint32_t));
+    }
+
+    return heap->node_count++;
+}
+
+static void insert_free(BufferHeap* heap, uint32_t n) {
+    HeapNode* node = heap->nodes + n;
+
+    uint32_t fl, sl;
+    bin_for(node->size, &fl, &sl);
+
+    node->free = true;
+    node->bin_prev = NODE_NONE;
+    node->bin_next = heap->bins[fl][sl];
+
+    if (node->bin_next != NODE_NONE) {
+        heap->nodes[node->bin_next].bin_prev = n;
+    }
+
+    heap->bins[fl][sl] = n;
+    heap->fl_bitmap |= 1u << fl;
+    heap->sl_bitmaps[fl] |= 1u << sl;
+    heap->free_range_count++;
+}
+
+static void remove_free(BufferHeap* heap, uint32_t n) {
+    HeapNode* node = heap->nodes + n;
+
+    uint32_t fl, sl;
+    bin_for(node->size, &fl, &sl);
+
+    if (node->bin_prev != NODE_NONE) {
+        heap->nodes[node->bin_prev].bin_next = node->bin_next;
+    }
+    else {
+        heap->bins[fl][sl] = node->bin_next;
+
+        if (node->bin_next == NODE_NONE) {
+            heap->sl_bitmaps[fl] &= ~(1u << sl);
+            if (!heap->sl_bitmaps[fl]) {
+                heap->fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+
+    if (node->bin_next != NODE_NONE) {
+        heap->nodes[node->bin_next].bin_prev = node->bin_prev;
+    }
+
+    node->free = false;
+    heap->free_range_count--;
+}
+
+// Any range in the returned bin is at least size: the size is rounded up to the next bin boundary first.
+static uint32_t find_free(BufferHeap* heap, uint32_t size) {
+    uint32_t units = size / BUFFER_HEAP_GRANULE;
+    if (units >= SL_COUNT) {
+        size += ((1u << (msb32(units) - SL_BITS)) - 1) * BUFFER_HEAP_GRANULE;
+    }
+
+    uint32_t fl, sl;
+    bin_for(size, &fl, &sl);
+
+    uint32_t sl_map = heap->sl_bitmaps[fl] & (~0u << sl);
+
+    if (!sl_map) {
+        uint32_t fl_map = heap->fl_bitmap & (~0u << (fl + 1));
+        if (!fl_map) {
+            return NODE_NONE;
+        }
+
+        fl = ctz32(fl_map);
+        sl_map = heap->sl_bitmaps[fl];
+    }
+
+    return heap->bins[fl][ctz32(sl_map)];
+}
+
+BufferHeap* buffer_heap_create(uint32_t block_size, BufferHeapBlockProc* create_block, void* user) {
+    assert(block_size >= BUFFER_HEAP_GRANULE && create_block);
+
+    BufferHeap* heap = (BufferHeap*)calloc(1, sizeof(BufferHeap));
+    heap->block_size = ROUND_GRANULE(block_size);
+    heap->create_block = create_block;
+    heap->user = user;
+
+    for (int fl = 0; fl < FL_COUNT; ++fl) {
+        for (int sl = 0; sl < SL_COUNT; ++sl) {
+            heap->bins[fl][sl] = NODE_NONE;
+        }
+    }
+
+    return heap;
+}
+
+void buffer_heap_free(BufferHeap* heap) {
+    free(heap->nodes);
+    free(heap->unused_nodes);
+    free(heap);
+}
+
+// Returns the free node covering the whole block.
+static uint32_t add_block(BufferHeap* heap, uint32_t size) {
+    uint32_t block = heap->block_count++;
+    heap->create_block(heap->user, block, size);
+    heap->reserved += size;
+
+    uint32_t n = new_node(heap);
+    HeapNode* node = heap->nodes + n;
+    node->block = block;
+    node->offset = 0;
+    node->size = size;
+    node->phys_prev = NODE_NONE;
+    node->phys_next = NODE_NONE;
+
+    insert_free(heap, n);
+
+    return n;
+}
+
+// Splits a free range off the end of node n, which must not be free.
+static void split_tail(BufferHeap* heap, uint32_t n, uint32_t size) {
+    uint32_t t = new_node(heap);
+    HeapNode* node = heap->nodes + n;
+    HeapNode* tail = heap->nodes + t;
+
+    tail->block = node->block;
+    tail->offset = node->offset + size;
+    tail->size = node->size - size;
+    tail->phys_prev = n;
+    tail->phys_next = node->phys_next;
+
+    if (node->phys_next != NODE_NONE) {
+        heap->nodes[node->phys_next].phys_prev = t;
+    }
+
+    node->phys_next = t;
+    node->size = size;
+
+    insert_free(heap, t);
+}
+
+BufferAlloc buffer_heap_alloc(BufferHeap* heap, uint32_t size, uint32_t alignment) {
+    assert(size > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (alignment < BUFFER_HEAP_GRANULE) {
+        alignment = BUFFER_HEAP_GRANULE;
+    }
+
+    size = ROUND_GRANULE(size);
+
+    // Reserving the worst-case padding keeps the search constant time.
+    uint32_t search_size = size + alignment - BUFFER_HEAP_GRANULE;
+
+    // A new block is taken directly: searching would round the size up to the next bin, which a block sized
+    // exactly to an oversized request doesn't reach.
+    uint32_t n = find_free(heap, search_size);
+    if (n == NODE_NONE) {
+        n = add_block(heap, search_size > heap->block_size ? search_size : heap->block_size);
+    }
+
+    remove_free(heap, n);
+
+    // Free neighbours are always merged, so the padding can't join the previous range and becomes its own.
+    uint32_t padding = ((heap->nodes[n].offset + alignment - 1) & ~(alignment - 1)) - heap->nodes[n].offset;
+    if (padding) {
+        uint32_t p = new_node(heap);
+        HeapNode* node = heap->nodes + n;
+        HeapNode* pad = heap->nodes + p;
+
+        pad->block = node->block;
+        pad->offset = node->offset;
+        pad->size = padding;
+        pad->phys_prev = node->phys_prev;
+        pad->phys_next = n;
+
+        if (node->phys_prev != NODE_NONE) {
+            heap->nodes[node->phys_prev].phys_next = p;
+        }
+
+        node->phys_prev = p;
+        node->offset += padding;
+        node->size -= padding;
+
+        insert_free(heap, p);
+    }
+
+    if (heap->nodes[n].size > size) {
+        split_tail(heap, n, size);
+    }
+
+    HeapNode* node = heap->nodes + n;
+
+    heap->alloc_count++;
+    heap->used += size;
+    if (heap->used > heap->peak_used) {
+        heap->peak_used = heap->used;
+    }
+
+    BufferAlloc alloc;
+    alloc.block = node->block;
+    alloc.offset = node->offset;
+    alloc.size = size;
+    alloc.node = n;
+
+    return alloc;
+}
+
+// Folds node b, which follows node a, into a.
+static void merge_next(BufferHeap* heap, uint32_t a, uint32_t b) {
+    HeapNode* first = heap->nodes + a;
+    HeapNode* second = heap->nodes + b;
+
+    first->size += second->size;
+    first->phys_next = second->phys_next;
+
+    if (second->phys_next != NODE_NONE) {
+        heap->nodes[second->phys_next].phys_prev = a;
+    }
+
+    heap->unused_nodes[heap->unused_count++] = b;
+}
+
+void buffer_heap_release(BufferHeap* heap, BufferAlloc alloc) {
+    uint32_t n = alloc.node;
+    assert(n < heap->node_count && !heap->nodes[n].free);
+    assert(heap->nodes[n].block == alloc.block && heap->nodes[n].offset == alloc.offset);
+
+    heap->alloc_count--;
+    heap->used -= heap->nodes[n].size;
+
+    uint32_t next = heap->nodes[n].phys_next;
+    if (next != NODE_NONE && heap->nodes[next].free) {
+        remove_free(heap, next);
+        merge_next(heap, n, next);
+    }
+
+    uint32_t prev = heap->nodes[n].phys_prev;
+    if (prev != NODE_NONE && heap->nodes[prev].free) {
+        remove_free(heap, prev);
+        merge_next(heap, prev, n);
+        n = prev;
+    }
+
+    insert_free(heap, n);
+}
+
+void buffer_heap_stats(BufferHeap* heap, BufferHeapStats* o_stats) {
+    memset(o_stats, 0, sizeof(BufferHeapStats));
+
+    o_stats->block_count = heap->block_count;
+    o_stats->alloc_count = heap->alloc_count;
+    o_stats->reserved = heap->reserved;
+    o_stats->used = heap->used;
+    o_stats->peak_used = heap->peak_used;
+    o_stats->free_ranges = heap->free_range_count;
+
+    // Only the highest non-empty bin can hold the largest range, but its sizes still vary.
+    if (heap->fl_bitmap) {
+        uint32_t fl = msb32(heap->fl_bitmap);
+        uint32_t sl = msb32(heap->sl_bitmaps[fl]);
+
+        for (uint32_t n = heap->bins[fl][sl]; n != NODE_NONE; n = heap->nodes[n].bin_next) {
+            if (heap->nodes[n].size > o_stats->largest_free) {
+                o_stats->largest_free = heap->nodes[n].size;
+            }
+        }
+    }
+
+    uint64_t free_bytes = heap->reserved - heap->used;
+    o_stats->fragmentation = free_bytes ? 1.0f - (float)o_stats->largest_free / (float)free_bytes : 0.0f;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+
+// Suballocates byte ranges out of large GPU buffer blocks, independent of any graphics API.
+// A two-level segregated fit (TLSF) allocator: free ranges sit in bins by size class, found through two levels
+// of bitmaps in constant time, and released ranges merge with free neighbours in the same block.
+// When nothing fits, a new block is requested from the backend through the create_block callback.
+
+#define BUFFER_HEAP_GRANULE 16
+
+struct BufferHeap;
+
+struct BufferAlloc {
+    uint32_t block;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t node;
+};
+
+struct BufferHeapStats {
+    uint32_t block_count;
+    uint32_t alloc_count;
+    uint64_t reserved; // Bytes in all blocks.
+    uint64_t used; // Bytes in live allocations, after rounding to the granule.
+    uint64_t peak_used;
+    uint32_t free_ranges;
+    uint32_t largest_free;
+
+    // 1 - largest_free / free bytes: 0 when all free space is one range.
+    float fragmentation;
+};
+
+// The backend creates its buffer for the block here. Blocks are never destroyed before the heap.
+typedef void BufferHeapBlockProc(void* user, uint32_t block, uint32_t size);
+
+// Allocations too large for block_size get a block of their own.
+BufferHeap* buffer_heap_create(uint32_t block_size, BufferHeapBlockProc* create_block, void* user);
+void buffer_heap_free(BufferHeap* heap);
+
+// alignment must be a power of two. Sizes and offsets are rounded to BUFFER_HEAP_GRANULE.
+BufferAlloc buffer_heap_alloc(BufferHeap* heap, uint32_t size, uint32_t alignment);
+
+// Frees at once; the caller delays this until the GPU is done with the range.
+void buffer_heap_release(BufferHeap* heap, BufferAlloc alloc);
+
+void buffer_heap_stats(BufferHeap* heap, BufferHeapStats* o_stats);
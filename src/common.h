@@ -1,8 +1,13 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <assert.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "platform.h"
 
 #define PI_32 3.14159265359f
@@ -10,3 +15,88 @@
 #define UNUSED(x) ((void)x)
 
 #define ARR_LEN(x) (sizeof(x)/sizeof(x[0]))
+
+struct Float2 {
+    float x, y;
+};
+
+struct Float3 {
+    float x, y, z;
+};
+
+
+static inline uint32_t ctz32(uint32_t x) {
+    assert(x);
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, x);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctz(x);
+#endif
+}
+
+// Index of the highest set bit.
+static inline uint32_t msb32(uint32_t x) {
+    assert(x);
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse(&idx, x);
+    return (uint32_t)idx;
+#else
+    return 31 - (uint32_t)__builtin_clz(x);
+#endif
+}
+
+static inline uint32_t popcount32(uint32_t x) {
+#if defined(_MSC_VER)
+    return (uint32_t)__popcnt(x);
+#else
+    return (uint32_t)__builtin_popcount(x);
+#endif
+}
+
+// Returns the value before the add.
+static inline uint32_t atomic_fetch_add32(volatile uint32_t* p, uint32_t v) {
+#if defined(_MSC_VER)
+    return (uint32_t)_InterlockedExchangeAdd((volatile long*)p, (long)v);
+#else
+    return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint32_t atomic_load32(volatile uint32_t* p) {
+#if defined(_MSC_VER)
+    uint32_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void atomic_store32(volatile uint32_t* p, uint32_t v) {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+    *p = v;
+#else
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+// Returns true if *p held expected and was replaced by desired.
+static inline bool atomic_cas32(volatile uint32_t* p, uint32_t expected, uint32_t desired) {
+#if defined(_MSC_VER)
+    return (uint32_t)_InterlockedCompareExchange((volatile long*)p, (long)desired, (long)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void atomic_fence() {
+#if defined(_MSC_VER)
+    _mm_mfence();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "gltf.h"
+#include "jobs.h"
+#include "mesh_blob.h"
+
+static void add_mesh(void* user, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    mesh_blob_add((MeshBlobBuilder*)user, vertex_data, vertex_count, index_data, index_count);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <model.gltf|model.glb> <out.mesh>\n", argv[0]);
+        return 1;
+    }
+
+    platform_init();
+
+    JobSystem* js = jobs_init(cpu_count());
+    MeshBlobBuilder* builder = mesh_blob_builder_create();
+
+    float start = engine_time();
+    GltfStats stats = {};
+    load_gltf(js, argv[1], add_mesh, builder, &stats);
+
+    size_t size = 0;
+    void* blob = mesh_blob_build(builder, &size);
+
+    FILE* f = fopen(argv[2], "wb");
+    if (!f) {
+        fprintf(stderr, "can't open %s for writing\n", argv[2]);
+        return 1;
+    }
+
+    bool written = fwrite(blob, 1, size, f) == size;
+    written = fclose(f) == 0 && written;
+
+    if (!written) {
+        fprintf(stderr, "failed writing %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%s -> %s: %zu bytes in %.3f ms\n", argv[1], argv[2], size, (engine_time() - start) * 1000.0f);
+    printf("acmr %.3f -> %.3f | atvr %.3f -> %.3f\n", mesh_opt_acmr(stats.opt_before), mesh_opt_acmr(stats.opt_after),
+           mesh_opt_atvr(stats.opt_before), mesh_opt_atvr(stats.opt_after));
+
+    if (stats.skipped_primitives) {
+        printf("%u primitives skipped\n", stats.skipped_primitives);
+    }
+
+    free(blob);
+    mesh_blob_builder_free(builder);
+    jobs_free(js);
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "descriptor_alloc.h"
+
+#define MAX_ORDER 32
+
+enum BlockState {
+    BLOCK_NONE, // Not the start of a block.
+    BLOCK_FREE,
+    BLOCK_USED,
+    BLOCK_PENDING,
+};
+
+struct PendingFree {
+    uint32_t first;
+    uint64_t fence;
+};
+
+struct DescriptorAllocator {
+    uint32_t capacity;
+
+    // Per slot, meaningful only where a block starts. Free blocks are linked through next and prev,
+    // while for allocated blocks next holds the requested count.
+    uint8_t* states;
+    uint8_t* orders;
+    uint32_t* next;
+    uint32_t* prev;
+
+    uint32_t heads[MAX_ORDER];
+    uint32_t free_blocks[MAX_ORDER];
+
+    uint32_t used;
+    uint32_t reserved;
+    uint32_t pending;
+    uint32_t peak;
+
+    PendingFree* pending_frees;
+    uint32_t pending_count;
+    uint32_t pending_cap;
+};
+
+static uint32_t order_for(uint32_t count) {
+    uint32_t order = 0;
+    while ((1u << order) < count) {
+        ++order;
+    }
+    return order;
+}
+
+static void push_free(DescriptorAllocator* a, uint32_t slot, uint32_t order) {
+    a->states[slot] = BLOCK_FREE;
+    a->orders[slot] = (uint8_t)order;
+    a->prev[slot] = DESCRIPTOR_INVALID;
+    a->next[slot] = a->heads[order];
+
+    if (a->heads[order] != DESCRIPTOR_INVALID) {
+        a->prev[a->heads[order]] = slot;
+    }
+
+    a->heads[order] = slot;
+    a->free_blocks[order]++;
+}
+
+static void unlink_free(DescriptorAllocator* a, uint32_t slot) {
+    uint32_t order = a->orders[slot];
+
+    if (a->prev[slot] != DESCRIPTOR_INVALID) {
+        a->next[a->prev[slot]] = a->next[slot];
+    }
+    else {
+        a->heads[order] = a->next[slot];
+    }
+
+    if (a->next[slot] != DESCRIPTOR_INVALID) {
+        a->prev[a->next[slot]] = a->prev[slot];
+    }
+
+    a->states[slot] = BLOCK_NONE;
+    a->free_blocks[order]--;
+}
+
+DescriptorAllocator* descriptor_allocator_create(uint32_t capacity) {
+    assert(capacity > 0 && capacity < DESCRIPTOR_INVALID);
+
+    DescriptorAllocator* a = (DescriptorAllocator*)calloc(1, sizeof(DescriptorAllocator));
+    a->capacity = capacity;
+
+    a->states = (uint8_t*)calloc(capacity, sizeof(uint8_t));
+    a->orders = (uint8_t*)calloc(capacity, sizeof(uint8_t));
+    a->next = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    a->prev = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+
+    for (int i = 0; i < MAX_ORDER; ++i) {
+        a->heads[i] = DESCRIPTOR_INVALID;
+    }
+
+    // Capacities that aren't a power of two start out as several maximal aligned blocks.
+    uint32_t offset = 0;
+    while (offset < capacity) {
+        uint32_t order = MAX_ORDER - 1;
+        while ((offset & ((1u << order) - 1)) || (uint64_t)offset + (1u << order) > capacity) {
+            --order;
+        }
+
+        push_free(a, offset, order);
+        offset += 1u << order;
+    }
+
+    return a;
+}
+
+void descriptor_allocator_free(DescriptorAllocator* a) {
+    free(a->states);
+    free(a->orders);
+    free(a->next);
+    free(a->prev);
+    free(a->pending_frees);
+    free(a);
+}
+
+uint32_t descriptor_alloc(DescriptorAllocator* a, uint32_t count) {
+    if (count == 0 || count > a->capacity) {
+        return DESCRIPTOR_INVALID;
+    }
+
+    uint32_t order = order_for(count);
+
+    uint32_t found = order;
+    while (found < MAX_ORDER && a->heads[found] == DESCRIPTOR_INVALID) {
+        ++found;
+    }
+
+    if (found == MAX_ORDER) {
+        return DESCRIPTOR_INVALID;
+    }
+
+    uint32_t slot = a->heads[found];
+    unlink_free(a, slot);
+
+    // Split down to the requested size, freeing the upper halves.
+    while (found > order) {
+        --found;
+        push_free(a, slot + (1u << found), found);
+    }
+
+    a->states[slot] = BLOCK_USED;
+    a->orders[slot] = (uint8_t)order;
+    a->next[slot] = count;
+
+    a->used += count;
+    a->reserved += 1u << order;
+
+    if (a->reserved + a->pending > a->peak) {
+        a->peak = a->reserved + a->pending;
+    }
+
+    return slot;
+}
+
+static void release_block(DescriptorAllocator* a, uint32_t slot, uint32_t order) {
+    a->states[slot] = BLOCK_NONE;
+
+    while (order + 1 < MAX_ORDER) {
+        uint32_t buddy = slot ^ (1u << order);
+
+        if (buddy >= a->capacity || a->states[buddy] != BLOCK_FREE || a->orders[buddy] != order) {
+            break;
+        }
+
+        unlink_free(a, buddy);
+        slot = slot < buddy ? slot : buddy;
+        ++order;
+    }
+
+    push_free(a, slot, order);
+}
+
+void descriptor_free(DescriptorAllocator* a, uint32_t first) {
+    assert(first < a->capacity && a->states[first] == BLOCK_USED);
+
+    uint32_t order = a->orders[first];
+    a->used -= a->next[first];
+    a->reserved -= 1u << order;
+
+    release_block(a, first, order);
+}
+
+void descriptor_free_deferred(DescriptorAllocator* a, uint32_t first, uint64_t fence) {
+    assert(first < a->capacity && a->states[first] == BLOCK_USED);
+
+    uint32_t size = 1u << a->orders[first];
+    a->used -= a->next[first];
+    a->reserved -= size;
+    a->pending += size;
+    a->states[first] = BLOCK_PENDING;
+
+    if (a->pending_count == a->pending_cap) {
+        a->pending_cap = a->pending_cap ? a->pending_cap * 2 : 64;
+        a->pending_frees = (PendingFree*)realloc(a->pending_frees, a->pending_cap * sizeof(PendingFree));
+    }
+
+    PendingFree* p = a->pending_frees + a->pending_count++;
+    p->first = first;
+    p->fence = fence;
+}
+
+void descriptor_retire(DescriptorAllocator* a, uint64_t completed_fence) {
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < a->pending_count; ++i) {
+        PendingFree p = a->pending_frees[i];
+
+        if (p.fence <= completed_fence) {
+            uint32_t order = a->orders[p.first];
+            a->pending -= 1u << order;
+            release_block(a, p.first, order);
+        }
+        else {
+            a->pending_frees[kept++] = p;
+        }
+    }
+
+    a->pending_count = kept;
+}
+
+void descriptor_stats(DescriptorAllocator* a, DescriptorStats* o_stats) {
+    memset(o_stats, 0, sizeof(DescriptorStats));
+
+    o_stats->capacity = a->capacity;
+    o_stats->used = a->used;
+    o_stats->reserved = a->reserved;
+    o_stats->pending = a->pending;
+    o_stats->peak = a->peak;
+
+    for (uint32_t order = 0; order < MAX_ORDER; ++order) {
+        o_stats->free_blocks += a->free_blocks[order];
+        if (a->free_blocks[order]) {
+            o_stats->largest_free = 1u << order;
+        }
+    }
+
+    uint32_t free_slots = a->capacity - a->reserved - a->pending;
+    o_stats->fragmentation = free_slots ? 1.0f - (float)o_stats->largest_free / (float)free_slots : 0.0f;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+
+// Hands out ranges of slots in a fixed-size descriptor heap, independent of any graphics API.
+// A binary buddy allocator: requests round up to a power of two, and freed blocks merge with their buddy.
+// Frees can be deferred until a fence value completes, so slots the GPU may still read are not reused early.
+
+#define DESCRIPTOR_INVALID UINT32_MAX
+
+struct DescriptorAllocator;
+
+struct DescriptorStats {
+    uint32_t capacity;
+    uint32_t used; // Slots requested by live allocations.
+    uint32_t reserved; // Slots held by live allocations after rounding, so reserved - used is internal waste.
+    uint32_t pending; // Slots freed but waiting on a fence.
+    uint32_t peak; // Highest reserved + pending seen.
+    uint32_t free_blocks;
+    uint32_t largest_free;
+
+    // 1 - largest_free / free slots: 0 when all free space is one block, approaching 1 as it splinters.
+    float fragmentation;
+};
+
+DescriptorAllocator* descriptor_allocator_create(uint32_t capacity);
+void descriptor_allocator_free(DescriptorAllocator* a);
+
+// Returns the first of count contiguous slots, or DESCRIPTOR_INVALID if no free block is large enough.
+uint32_t descriptor_alloc(DescriptorAllocator* a, uint32_t count);
+
+// first must come from descriptor_alloc, and the whole allocation is freed.
+void descriptor_free(DescriptorAllocator* a, uint32_t first);
+
+// Frees once descriptor_retire is passed a completed fence of at least fence.
+void descriptor_free_deferred(DescriptorAllocator* a, uint32_t first, uint64_t fence);
+void descriptor_retire(DescriptorAllocator* a, uint64_t completed_fence);
+
+void descriptor_stats(DescriptorAllocator* a, DescriptorStats* o_stats);
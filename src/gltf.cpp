@@ -0,0 +1,1066 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define GLTF_SSE 1
+#endif
+
+#include "gltf.h"
+#include "json.h"
+#include "base64.h"
+#include "hash.h"
+#include "mesh_blob.h"
+
+// Buffers decoded from data URIs are owned; the GLB BIN chunk is borrowed from the mapped file.
+struct GltfBuffer {
+    size_t len;
+    void* data;
+    bool owned;
+};
+
+struct GltfBufferView {
+    void* ptr;
+    size_t len;
+    uint32_t stride;
+};
+
+enum GltfType {
+    GLTF_BYTE = 0x1400,
+    GLTF_UNSIGNED_BYTE = 0x1401,
+    GLTF_SHORT = 0x1402,
+    GLTF_UNSIGNED_SHORT = 0x1403,
+    GLTF_INT = 0x1404,
+    GLTF_UNSIGNED_INT = 0x1405,
+    GLTF_FLOAT = 0x1406,
+};
+
+enum GltfMode {
+    GLTF_POINTS,
+    GLTF_LINES,
+    GLTF_LINE_LOOP,
+    GLTF_LINE_STRIP,
+    GLTF_TRIANGLES,
+    GLTF_TRIANGLE_STRIP,
+    GLTF_TRIANGLE_FAN,
+};
+
+// ptr is NULL for accessors without a buffer view, which read as zeros before sparse values are applied.
+// Sparse values are tightly packed; sparse indices are unsigned integers of sparse_index_type.
+struct GltfAccessor {
+    void* ptr;
+    GltfType type;
+    uint32_t count;
+    int component_count;
+    uint32_t stride;
+    bool normalized;
+
+    uint32_t sparse_count;
+    void* sparse_indices;
+    GltfType sparse_index_type;
+    void* sparse_values;
+};
+
+static uint32_t component_size(GltfType type) {
+    switch (type) {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:
+            return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT:
+            return 2;
+        case GLTF_INT:
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:
+            return 4;
+    }
+    assert(false && "Invalid component type");
+    return 0;
+}
+
+static float read_float(char* p, GltfType type, bool normalized) {
+    switch (type) {
+        case GLTF_FLOAT: {
+            float f;
+            memcpy(&f, p, sizeof(f));
+            return f;
+        }
+        case GLTF_BYTE: {
+            float f = (float)*(int8_t*)p;
+            return normalized ? (f / 127.0f < -1.0f ? -1.0f : f / 127.0f) : f;
+        }
+        case GLTF_UNSIGNED_BYTE: {
+            float f = (float)*(uint8_t*)p;
+            return normalized ? f / 255.0f : f;
+        }
+        case GLTF_SHORT: {
+            int16_t v;
+            memcpy(&v, p, sizeof(v));
+            float f = (float)v;
+            return normalized ? (f / 32767.0f < -1.0f ? -1.0f : f / 32767.0f) : f;
+        }
+        case GLTF_UNSIGNED_SHORT: {
+            uint16_t v;
+            memcpy(&v, p, sizeof(v));
+            float f = (float)v;
+            return normalized ? f / 65535.0f : f;
+        }
+        case GLTF_INT: {
+            int32_t v;
+            memcpy(&v, p, sizeof(v));
+            return (float)v;
+        }
+        case GLTF_UNSIGNED_INT: {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return (float)v;
+        }
+    }
+    return 0.0f;
+}
+
+static uint32_t read_uint(char* p, GltfType type) {
+    switch (type) {
+        case GLTF_UNSIGNED_BYTE:
+            return *(uint8_t*)p;
+        case GLTF_UNSIGNED_SHORT: {
+            uint16_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case GLTF_UNSIGNED_INT: {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+    }
+    assert(false && "Indices must be unsigned integers");
+    return 0;
+}
+
+static void convert_floats(char* src, uint32_t src_stride, GltfType type, bool normalized, int components,
+                           uint32_t count, float* out, uint32_t out_stride) {
+    uint32_t size = component_size(type);
+
+    if (type == GLTF_FLOAT) {
+        for (uint32_t i = 0; i < count; ++i) {
+            memcpy(out + i * out_stride, src + (size_t)i * src_stride, components * sizeof(float));
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        char* el = src + (size_t)i * src_stride;
+        for (int c = 0; c < components; ++c) {
+            out[i * out_stride + c] = read_float(el + c * size, type, normalized);
+        }
+    }
+}
+
+// Writes the first out_components components of each element as floats, out_stride floats apart.
+// Components the accessor doesn't have are left untouched.
+static void accessor_read_floats(GltfAccessor* a, float* out, int out_components, uint32_t out_stride) {
+    int components = a->component_count < out_components ? a->component_count : out_components;
+
+    if (a->ptr) {
+        convert_floats((char*)a->ptr, a->stride, a->type, a->normalized, components, a->count, out, out_stride);
+    }
+    else {
+        for (uint32_t i = 0; i < a->count; ++i) {
+            memset(out + i * out_stride, 0, components * sizeof(float));
+        }
+    }
+
+    uint32_t value_size = component_size(a->type) * a->component_count;
+    uint32_t index_size = a->sparse_count ? component_size(a->sparse_index_type) : 0;
+
+    for (uint32_t i = 0; i < a->sparse_count; ++i) {
+        uint32_t target = read_uint((char*)a->sparse_indices + i * index_size, a->sparse_index_type);
+        assert(target < a->count);
+
+        char* value = (char*)a->sparse_values + (size_t)i * value_size;
+        convert_floats(value, value_size, a->type, a->normalized, components, 1, out + (size_t)target * out_stride, out_stride);
+    }
+}
+
+static void widen_indices(char* src, uint32_t stride, GltfType type, uint32_t count, uint32_t* out) {
+    uint32_t i = 0;
+
+    if (type == GLTF_UNSIGNED_INT && stride == 4) {
+        memcpy(out, src, count * sizeof(uint32_t));
+        return;
+    }
+
+#if GLTF_SSE
+    __m128i zero = _mm_setzero_si128();
+
+    if (type == GLTF_UNSIGNED_SHORT && stride == 2) {
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128((__m128i*)(src + i * 2));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(v, zero));
+            _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(v, zero));
+        }
+    }
+    else if (type == GLTF_UNSIGNED_BYTE && stride == 1) {
+        for (; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128((__m128i*)(src + i));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128((__m128i*)(out + i + 12), _mm_unpackhi_epi16(hi, zero));
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        out[i] = read_uint(src + (size_t)i * stride, type);
+    }
+}
+
+static void accessor_read_indices(GltfAccessor* a, uint32_t* out) {
+    if (a->ptr) {
+        widen_indices((char*)a->ptr, a->stride, a->type, a->count, out);
+    }
+    else {
+        memset(out, 0, a->count * sizeof(uint32_t));
+    }
+
+    uint32_t index_size = a->sparse_count ? component_size(a->sparse_index_type) : 0;
+    uint32_t value_size = component_size(a->type);
+
+    for (uint32_t i = 0; i < a->sparse_count; ++i) {
+        uint32_t target = read_uint((char*)a->sparse_indices + i * index_size, a->sparse_index_type);
+        assert(target < a->count);
+        out[target] = read_uint((char*)a->sparse_values + i * value_size, a->type);
+    }
+}
+
+static bool is_packed_float(GltfAccessor* a, int component_count) {
+    return a && a->ptr && a->type == GLTF_FLOAT && a->component_count == component_count && !a->sparse_count;
+}
+
+// Interleaves float3 positions, float3 normals and float2 uvs, the layout nearly every exporter writes.
+static void interleave_vertices(GltfAccessor* pos, GltfAccessor* norm, GltfAccessor* uvs, RDMeshVertex* out) {
+    uint32_t count = pos->count;
+    uint32_t i = 0;
+
+    char* p = (char*)pos->ptr;
+    char* n = (char*)norm->ptr;
+    char* t = (char*)uvs->ptr;
+
+#if GLTF_SSE
+    // Position and normal loads read one float past their element, which is still inside the next element,
+    // so the last vertex is left to the scalar loop.
+    for (; i + 1 < count; ++i) {
+        __m128 pv = _mm_loadu_ps((float*)(p + (size_t)i * pos->stride));
+        __m128 nv = _mm_loadu_ps((float*)(n + (size_t)i * norm->stride));
+        __m128 tv = _mm_castpd_ps(_mm_load_sd((double*)(t + (size_t)i * uvs->stride)));
+
+        __m128 pz_nx = _mm_shuffle_ps(pv, nv, _MM_SHUFFLE(0, 0, 2, 2));
+        __m128 lo = _mm_shuffle_ps(pv, pz_nx, _MM_SHUFFLE(2, 0, 1, 0));
+        __m128 hi = _mm_shuffle_ps(nv, tv, _MM_SHUFFLE(1, 0, 2, 1));
+
+        float* v = (float*)(out + i);
+        _mm_storeu_ps(v, lo);
+        _mm_storeu_ps(v + 4, hi);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        RDMeshVertex* v = out + i;
+        memcpy(&v->pos, p + (size_t)i * pos->stride, sizeof(Float3));
+        memcpy(&v->norm, n + (size_t)i * norm->stride, sizeof(Float3));
+        memcpy(&v->uv, t + (size_t)i * uvs->stride, sizeof(Float2));
+    }
+}
+
+#define GLB_MAGIC 0x46546C67
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN 0x004E4942
+
+struct GlbHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+};
+
+struct GlbChunkHeader {
+    uint32_t length;
+    uint32_t type;
+};
+
+// Returns a terminated copy of the JSON chunk, and points o_bin at the BIN chunk inside the mapped file if there is one.
+static char* parse_glb(char* file, size_t file_size, GltfBuffer* o_bin) {
+    GlbHeader* header = (GlbHeader*)file;
+    assert(header->magic == GLB_MAGIC);
+    assert(header->version == 2 && "Only glb version 2 supported");
+    assert(header->length <= file_size);
+    UNUSED(file_size);
+
+    char* cursor = file + sizeof(GlbHeader);
+    char* end = file + header->length;
+
+    assert((size_t)(end - cursor) >= sizeof(GlbChunkHeader));
+    GlbChunkHeader* json_chunk = (GlbChunkHeader*)cursor;
+    assert(json_chunk->type == GLB_CHUNK_JSON && "First glb chunk must be JSON");
+
+    char* json_data = cursor + sizeof(GlbChunkHeader);
+    assert(json_chunk->length <= (size_t)(end - json_data));
+
+    // The BIN chunk header follows the JSON directly, so it can't be terminated in place.
+    char* json_str = (char*)malloc(json_chunk->length + 1);
+    memcpy(json_str, json_data, json_chunk->length);
+    json_str[json_chunk->length] = '\0';
+
+    cursor = json_data + json_chunk->length;
+
+    while ((size_t)(end - cursor) >= sizeof(GlbChunkHeader)) {
+        GlbChunkHeader* chunk = (GlbChunkHeader*)cursor;
+        char* data = cursor + sizeof(GlbChunkHeader);
+        assert(chunk->length <= (size_t)(end - data));
+
+        if (chunk->type == GLB_CHUNK_BIN && !o_bin->data) {
+            o_bin->data = data;
+            o_bin->len = chunk->length;
+        }
+
+        cursor = data + chunk->length;
+    }
+
+    return json_str;
+}
+
+struct GltfPrimitive {
+    GltfAccessor* pos;
+    GltfAccessor* norm;
+    GltfAccessor* uvs;
+    GltfAccessor* indices;
+    GltfMode mode;
+
+    // Set by convert_primitive for primitives that can't be drawn as triangles; they never reach proc.
+    bool skipped;
+
+    RDMeshVertex* vertex_data;
+    uint32_t vertex_count;
+    uint32_t* index_data;
+    uint32_t index_count;
+
+    MeshOptStats opt_before;
+    MeshOptStats opt_after;
+};
+
+// Expands a strip or fan into a list, with the winding the glTF spec gives each triangle.
+static uint32_t* triangulate(GltfMode mode, uint32_t* index_data, uint32_t index_count, uint32_t* o_count) {
+    uint32_t triangle_count = index_count >= 3 ? index_count - 2 : 0;
+    uint32_t* list = (uint32_t*)malloc(triangle_count * 3 * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        uint32_t* tri = list + i * 3;
+
+        if (mode == GLTF_TRIANGLE_STRIP) {
+            tri[0] = index_data[i];
+            tri[1] = index_data[i + 1 + i % 2];
+            tri[2] = index_data[i + 2 - i % 2];
+        }
+        else {
+            tri[0] = index_data[i + 1];
+            tri[1] = index_data[i + 2];
+            tri[2] = index_data[0];
+        }
+    }
+
+    *o_count = triangle_count * 3;
+    return list;
+}
+
+static void convert_primitive(GltfPrimitive* prim) {
+    // Points and lines have nothing the renderers can draw.
+    if (prim->mode < GLTF_TRIANGLES || prim->mode > GLTF_TRIANGLE_FAN) {
+        prim->skipped = true;
+        return;
+    }
+
+    GltfAccessor* pos = prim->pos;
+    GltfAccessor* norm = prim->norm;
+    GltfAccessor* uvs = prim->uvs;
+    GltfAccessor* indices = prim->indices;
+
+    uint32_t vertex_count = pos->count;
+    RDMeshVertex* vertex_data = (RDMeshVertex*)calloc(vertex_count, sizeof(RDMeshVertex));
+
+    uint32_t vertex_stride = sizeof(RDMeshVertex) / sizeof(float);
+
+    if (is_packed_float(pos, 3) && is_packed_float(norm, 3) && is_packed_float(uvs, 2)) {
+        interleave_vertices(pos, norm, uvs, vertex_data);
+    }
+    else {
+        accessor_read_floats(pos, &vertex_data->pos.x, 3, vertex_stride);
+
+        if (norm) {
+            accessor_read_floats(norm, &vertex_data->norm.x, 3, vertex_stride);
+        }
+
+        if (uvs) {
+            accessor_read_floats(uvs, &vertex_data->uv.x, 2, vertex_stride);
+        }
+    }
+
+    uint32_t index_count = indices ? indices->count : vertex_count;
+    uint32_t* index_data = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+
+    if (indices) {
+        accessor_read_indices(indices, index_data);
+    }
+    else {
+        for (uint32_t i = 0; i < index_count; ++i) {
+            index_data[i] = i;
+        }
+    }
+
+    if (prim->mode != GLTF_TRIANGLES) {
+        uint32_t* list = triangulate(prim->mode, index_data, index_count, &index_count);
+        free(index_data);
+        index_data = list;
+    }
+
+    // The renderers index the vertex data directly, and optimize_mesh passes invalid lists through untouched.
+    uint32_t max_index = 0;
+    for (uint32_t i = 0; i < index_count; ++i) {
+        max_index = index_data[i] > max_index ? index_data[i] : max_index;
+    }
+
+    if (index_count == 0 || index_count % 3 != 0 || max_index >= vertex_count) {
+        free(index_data);
+        free(vertex_data);
+        prim->skipped = true;
+        return;
+    }
+
+    vertex_count = optimize_mesh(vertex_data, vertex_count, index_data, index_count, &prim->opt_before, &prim->opt_after);
+
+    prim->vertex_data = vertex_data;
+    prim->vertex_count = vertex_count;
+    prim->index_data = index_data;
+    prim->index_count = index_count;
+}
+
+static void add_opt_stats(MeshOptStats* total, MeshOptStats stats) {
+    total->triangle_count += stats.triangle_count;
+    total->vertex_count += stats.vertex_count;
+    total->transform_count += stats.transform_count;
+}
+
+static void convert_primitives(void* arg, uint32_t begin, uint32_t end) {
+    GltfPrimitive* prims = (GltfPrimitive*)arg;
+
+    for (uint32_t i = begin; i < end; ++i) {
+        convert_primitive(prims + i);
+    }
+}
+
+// Embedded buffers are base64 decoded and external ones read from disk, both as jobs.
+struct GltfBufferLoad {
+    GltfBuffer* buf;
+    char* path;
+    char* base64;
+    size_t base64_len;
+};
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Length of the directory part of path, including the trailing separator.
+static size_t path_dir_len(char* path) {
+    size_t len = 0;
+    for (size_t i = 0; path[i]; ++i) {
+        if (path[i] == '/' || path[i] == '\\') {
+            len = i + 1;
+        }
+    }
+    return len;
+}
+
+// Resolves a relative uri against the directory of the glTF file, decoding percent escapes.
+static char* resolve_uri(char* gltf_path, char* uri, size_t uri_len) {
+    size_t dir_len = path_dir_len(gltf_path);
+
+    char* path = (char*)malloc(dir_len + uri_len + 1);
+    memcpy(path, gltf_path, dir_len);
+
+    char* out = path + dir_len;
+
+    for (size_t i = 0; i < uri_len; ++i) {
+        if (uri[i] == '%' && i + 2 < uri_len && hex_value(uri[i + 1]) >= 0 && hex_value(uri[i + 2]) >= 0) {
+            *out++ = (char)(hex_value(uri[i + 1]) * 16 + hex_value(uri[i + 2]));
+            i += 2;
+        }
+        else {
+            *out++ = uri[i];
+        }
+    }
+
+    *out = '\0';
+
+    return path;
+}
+
+static void load_buffer(GltfBufferLoad* load) {
+    GltfBuffer* buf = load->buf;
+
+    if (load->path) {
+        size_t read = read_file(load->path, buf->data, buf->len);
+        assert(read == buf->len && "Buffer file is smaller than its byteLength");
+        UNUSED(read);
+    }
+    else {
+        size_t decoded_len = 0;
+        bool ok = base64_decode(load->base64, load->base64_len, buf->data, buf->len, &decoded_len);
+        assert(ok && decoded_len == buf->len);
+        UNUSED(ok);
+    }
+}
+
+static void load_buffer_job(void* arg) {
+    load_buffer((GltfBufferLoad*)arg);
+}
+
+static uint64_t hash_file(char* path) {
+    size_t size = 0;
+    char* data = map_file(path, &size);
+    uint64_t h = hash64(data, size, 0);
+    unmap_file(data, size);
+    return h;
+}
+
+// External files a load read besides the glTF itself, with the hash of what was read.
+struct GltfDeps {
+    char** paths;
+    uint64_t* hashes;
+    int count;
+};
+
+static void load_gltf_source(JobSystem* js, char* path, GltfMeshProc* proc, void* user, GltfStats* o_stats, GltfDeps* o_deps) {
+    float start_time = engine_time();
+
+    size_t file_size = 0;
+    char* file = map_file(path, &file_size);
+
+    bool is_glb = file_size >= sizeof(GlbHeader) && ((GlbHeader*)file)->magic == GLB_MAGIC;
+
+    char* gltf_str = file;
+    GltfBuffer bin = {};
+
+    if (is_glb) {
+        gltf_str = parse_glb(file, file_size, &bin);
+    }
+
+    int parse_flags = JSON_PARSE_IN_SITU;
+    if (!is_glb) {
+        parse_flags |= JSON_PARSE_BORROW_SOURCE;
+    }
+
+    float map_done_time = engine_time();
+
+    // Hashed once here rather than on every lookup in the loops below.
+    JsonKey key_byte_length = json_key("byteLength");
+    JsonKey key_byte_offset = json_key("byteOffset");
+    JsonKey key_uri = json_key("uri");
+    JsonKey key_buffer = json_key("buffer");
+    JsonKey key_buffer_view = json_key("bufferView");
+    JsonKey key_component_type = json_key("componentType");
+    JsonKey key_count = json_key("count");
+    JsonKey key_type = json_key("type");
+    JsonKey key_primitives = json_key("primitives");
+    JsonKey key_attributes = json_key("attributes");
+    JsonKey key_indices = json_key("indices");
+    JsonKey key_mode = json_key("mode");
+    JsonKey key_position = json_key("POSITION");
+    JsonKey key_normal = json_key("NORMAL");
+    JsonKey key_texcoord_0 = json_key("TEXCOORD_0");
+    JsonKey key_byte_stride = json_key("byteStride");
+    JsonKey key_normalized = json_key("normalized");
+    JsonKey key_sparse = json_key("sparse");
+
+    // Only the buffers member is parsed up front, so their loads can start before the full parse.
+    JsonDoc* buf_doc = json_doc_parse_member(gltf_str, "buffers");
+    assert(buf_doc && "Missing buffers");
+
+    Json* buf_list = buf_doc->root;
+    GltfBuffer* bufs = (GltfBuffer*)calloc(json_array_len(buf_list), sizeof(GltfBuffer));
+    int buf_count = 0;
+
+    GltfBufferLoad* loads = (GltfBufferLoad*)calloc(json_array_len(buf_list), sizeof(GltfBufferLoad));
+    int load_count = 0;
+
+    JSON_ARRAY_FOR(buf_list, buf_info) {
+        GltfBuffer* buf = bufs + buf_count++;
+
+        buf->len = (size_t)json_u64(json_lookup_key(buf_info, key_byte_length));
+
+        if (!json_has_key(buf_info, key_uri)) {
+            assert(buf_count == 1 && bin.data && "Only the first buffer of a glb may omit its uri");
+            assert(buf->len <= bin.len);
+            buf->data = bin.data;
+            continue;
+        }
+
+        buf->data = malloc(buf->len);
+        buf->owned = true;
+
+        Json* uri = json_lookup_key(buf_info, key_uri);
+        char* uri_str = json_string(uri);
+        size_t uri_len = json_string_len(uri);
+
+        GltfBufferLoad* load = loads + load_count++;
+        load->buf = buf;
+
+        if (uri_len >= 5 && memcmp(uri_str, "data:", 5) == 0) {
+            const char base64_marker[] = ";base64,";
+            size_t marker_len = sizeof(base64_marker) - 1;
+
+            char* comma = (char*)memchr(uri_str, ',', uri_len);
+            assert(comma && (size_t)(comma - uri_str) + 1 >= marker_len && "Only base64 data uris are supported");
+            assert(memcmp(comma + 1 - marker_len, base64_marker, marker_len) == 0 && "Only base64 data uris are supported");
+            UNUSED(marker_len);
+
+            load->base64 = comma + 1;
+            load->base64_len = uri_len - (load->base64 - uri_str);
+        }
+        else {
+            assert(!memchr(uri_str, ':', uri_len) && "Only relative buffer uris are supported");
+            load->path = resolve_uri(path, uri_str, uri_len);
+        }
+    }
+
+    // Buffer contents are only needed once the meshes are built, so they load while the rest of the document
+    // is parsed and views and accessors are resolved.
+    JobCounter buffers_loaded = {};
+
+    for (int i = 0; i < load_count; ++i) {
+        jobs_run(js, load_buffer_job, loads + i, &buffers_loaded);
+    }
+
+    JsonDoc* doc = json_doc_parse_parallel(js, gltf_str, parse_flags);
+
+    float parse_done_time = engine_time();
+
+    Json* root = doc->root;
+
+    char* version = json_string(json_lookup(json_lookup(root, "asset"), "version"));
+    
+    if (strcmp(version, "2.0") != 0) {
+        message_box("Only gltf 2.0 supported");
+    }
+
+    Json* view_list = json_lookup(root, "bufferViews");
+    GltfBufferView* views = (GltfBufferView*)calloc(json_array_len(view_list), sizeof(GltfBufferView));
+    int view_count = 0;
+
+    JSON_ARRAY_FOR(view_list, view_info) {
+        GltfBufferView* view = views + view_count++;
+
+        view->len = (size_t)json_u64(json_lookup_key(view_info, key_byte_length));
+
+        if (json_has_key(view_info, key_byte_stride)) {
+            view->stride = (uint32_t)json_u64(json_lookup_key(view_info, key_byte_stride));
+        }
+
+        int buf_index = (int)json_i64(json_lookup_key(view_info, key_buffer));
+        assert(buf_index < buf_count);
+        GltfBuffer* buf = bufs + buf_index;
+        
+        size_t offset = 0;
+        if (json_has_key(view_info, key_byte_offset)) {
+            offset = (size_t)json_u64(json_lookup_key(view_info, key_byte_offset));
+        }
+
+        assert(offset + view->len <= buf->len);
+        view->ptr = (char*)buf->data + offset;
+    }
+
+    Json* accessor_list = json_lookup(root, "accessors");
+    GltfAccessor* accessors = (GltfAccessor*)calloc(json_array_len(accessor_list), sizeof(GltfAccessor));
+    int accessor_count = 0;
+
+    JSON_ARRAY_FOR(accessor_list, accessor_info) {
+        GltfAccessor* accessor = accessors + accessor_count++;
+
+        accessor->type = (GltfType)json_i64(json_lookup_key(accessor_info, key_component_type));
+        accessor->count = (uint32_t)json_u64(json_lookup_key(accessor_info, key_count));
+
+        char* type = json_string(json_lookup_key(accessor_info, key_type));
+        if (strcmp(type, "SCALAR") == 0) {
+            accessor->component_count = 1;
+        }
+        else if (strcmp(type, "VEC2") == 0) {
+            accessor->component_count = 2;
+        }
+        else if (strcmp(type, "VEC3") == 0) {
+            accessor->component_count = 3;
+        }
+        else if (strcmp(type, "VEC4") == 0 || strcmp(type, "MAT2") == 0) {
+            accessor->component_count = 4;
+        }
+        else if (strcmp(type, "MAT3") == 0) {
+            accessor->component_count = 9;
+        }
+        else if (strcmp(type, "MAT4") == 0) {
+            accessor->component_count = 16;
+        }
+        else {
+            assert(false);
+        }
+
+        if (json_has_key(accessor_info, key_normalized)) {
+            accessor->normalized = json_boolean(json_lookup_key(accessor_info, key_normalized));
+        }
+
+        uint32_t element_size = component_size(accessor->type) * accessor->component_count;
+        accessor->stride = element_size;
+
+        if (json_has_key(accessor_info, key_buffer_view)) {
+            size_t offset = 0;
+
+            if (json_has_key(accessor_info, key_byte_offset)) {
+                offset = (size_t)json_u64(json_lookup_key(accessor_info, key_byte_offset));
+            }
+        
+            int view_index = (int)json_i64(json_lookup_key(accessor_info, key_buffer_view));
+            assert(view_index < view_count);
+            GltfBufferView* view = views + view_index;
+
+            if (view->stride) {
+                accessor->stride = view->stride;
+            }
+
+            assert(accessor->count == 0 || offset + (size_t)(accessor->count - 1) * accessor->stride + element_size <= view->len);
+            accessor->ptr = (char*)view->ptr + offset;
+        }
+
+        if (json_has_key(accessor_info, key_sparse)) {
+            Json* sparse = json_lookup_key(accessor_info, key_sparse);
+            Json* sparse_indices = json_lookup(sparse, "indices");
+            Json* sparse_values = json_lookup(sparse, "values");
+
+            accessor->sparse_count = (uint32_t)json_u64(json_lookup_key(sparse, key_count));
+            accessor->sparse_index_type = (GltfType)json_i64(json_lookup_key(sparse_indices, key_component_type));
+
+            Json* parts[2] = { sparse_indices, sparse_values };
+            void** ptrs[2] = { &accessor->sparse_indices, &accessor->sparse_values };
+
+            for (int i = 0; i < 2; ++i) {
+                int view_index = (int)json_i64(json_lookup_key(parts[i], key_buffer_view));
+                assert(view_index < view_count);
+
+                size_t offset = 0;
+                if (json_has_key(parts[i], key_byte_offset)) {
+                    offset = (size_t)json_u64(json_lookup_key(parts[i], key_byte_offset));
+                }
+
+                // Sparse indices and values are tightly packed.
+                size_t part_size = (size_t)accessor->sparse_count * (i == 0 ? component_size(accessor->sparse_index_type) : element_size);
+                assert(offset + part_size <= views[view_index].len);
+                UNUSED(part_size);
+                *ptrs[i] = (char*)views[view_index].ptr + offset;
+            }
+        }
+    }
+
+    Json* mesh_list = json_lookup(root, "meshes");
+
+    uint32_t prim_total = 0;
+    JSON_ARRAY_FOR(mesh_list, mesh) {
+        prim_total += (uint32_t)json_array_len(json_lookup_key(mesh, key_primitives));
+    }
+
+    GltfPrimitive* prims = (GltfPrimitive*)calloc(prim_total, sizeof(GltfPrimitive));
+    uint32_t prim_count = 0;
+
+    JSON_ARRAY_FOR(mesh_list, mesh) {
+        JSON_ARRAY_FOR(json_lookup_key(mesh, key_primitives), prim_info) {
+            GltfPrimitive* prim = prims + prim_count++;
+
+            Json* attributes = json_lookup_key(prim_info, key_attributes);
+
+            prim->mode = GLTF_TRIANGLES;
+            if (json_has_key(prim_info, key_mode)) {
+                prim->mode = (GltfMode)json_i64(json_lookup_key(prim_info, key_mode));
+            }
+
+            assert(json_has_key(attributes, key_position));
+
+            uint32_t pos_index = (uint32_t)json_u64(json_lookup_key(attributes, key_position));
+            assert(pos_index < (uint32_t)accessor_count);
+            prim->pos = accessors + pos_index;
+
+            if (json_has_key(attributes, key_normal)) {
+                uint32_t index = (uint32_t)json_u64(json_lookup_key(attributes, key_normal));
+                assert(index < (uint32_t)accessor_count);
+                prim->norm = accessors + index;
+                assert(prim->norm->count == prim->pos->count);
+            }
+
+            if (json_has_key(attributes, key_texcoord_0)) {
+                uint32_t index = (uint32_t)json_u64(json_lookup_key(attributes, key_texcoord_0));
+                assert(index < (uint32_t)accessor_count);
+                prim->uvs = accessors + index;
+                assert(prim->uvs->count == prim->pos->count);
+            }
+
+            if (json_has_key(prim_info, key_indices)) {
+                uint32_t index = (uint32_t)json_u64(json_lookup_key(prim_info, key_indices));
+                assert(index < (uint32_t)accessor_count);
+                prim->indices = accessors + index;
+                assert(prim->indices->component_count == 1);
+            }
+        }
+    }
+
+    float resolve_done_time = engine_time();
+
+    jobs_wait(js, &buffers_loaded);
+
+    float buffers_done_time = engine_time();
+
+    // Data uris point into the buffers document, so it lives until every load has finished.
+    json_doc_free(buf_doc);
+
+    if (o_deps) {
+        o_deps->paths = (char**)calloc(load_count + 1, sizeof(char*));
+        o_deps->hashes = (uint64_t*)calloc(load_count + 1, sizeof(uint64_t));
+
+        for (int i = 0; i < load_count; ++i) {
+            GltfBufferLoad* load = loads + i;
+            if (load->path) {
+                o_deps->paths[o_deps->count] = load->path;
+                o_deps->hashes[o_deps->count] = hash_file(load->path);
+                o_deps->count++;
+                load->path = NULL;
+            }
+        }
+    }
+
+    for (int i = 0; i < load_count; ++i) {
+        free(loads[i].path);
+    }
+
+    free(loads);
+
+    // Primitives convert in parallel, then go to proc in file order on the calling thread.
+    parallel_for(js, prim_count, 1, convert_primitives, prims);
+
+    MeshOptStats opt_before = {};
+    MeshOptStats opt_after = {};
+    uint32_t skipped_primitives = 0;
+
+    for (uint32_t i = 0; i < prim_count; ++i) {
+        GltfPrimitive* prim = prims + i;
+
+        if (prim->skipped) {
+            ++skipped_primitives;
+            continue;
+        }
+
+        add_opt_stats(&opt_before, prim->opt_before);
+        add_opt_stats(&opt_after, prim->opt_after);
+
+        proc(user, prim->vertex_data, prim->vertex_count, prim->index_data, prim->index_count);
+
+        free(prim->index_data);
+        free(prim->vertex_data);
+    }
+
+    free(prims);
+
+    for (int i = 0; i < buf_count; ++i) {
+        if (bufs[i].owned) {
+            free(bufs[i].data);
+        }
+    }
+
+    free(accessors);
+    free(views);
+    free(bufs);
+
+    json_doc_free(doc);
+    unmap_file(file, file_size);
+
+    if (o_stats) {
+        float end_time = engine_time();
+        o_stats->map_time = map_done_time - start_time;
+        o_stats->parse_time = parse_done_time - map_done_time;
+        o_stats->resolve_time = resolve_done_time - parse_done_time;
+        o_stats->buffer_wait_time = buffers_done_time - resolve_done_time;
+        o_stats->mesh_time = end_time - buffers_done_time;
+        o_stats->cache_hit = false;
+        o_stats->opt_before = opt_before;
+        o_stats->opt_after = opt_after;
+        o_stats->skipped_primitives = skipped_primitives;
+    }
+}
+
+void load_gltf(JobSystem* js, char* path, GltfMeshProc* proc, void* user, GltfStats* o_stats) {
+    load_gltf_source(js, path, proc, user, o_stats, NULL);
+}
+
+// Bump whenever conversion output changes, so stale cache entries stop matching.
+#define GLTF_LOADER_VERSION 4
+
+#define GLTF_DEPS_HEADER "deez-gltf-deps 2\n"
+
+static void free_deps(GltfDeps* deps) {
+    for (int i = 0; i < deps->count; ++i) {
+        free(deps->paths[i]);
+    }
+
+    free(deps->paths);
+    free(deps->hashes);
+}
+
+// Each line after the header is "<hash> <path>" for one external buffer the cached meshes were built from.
+// Paths are relative to the glTF, so an identical glTF elsewhere is checked against the buffers next to it.
+static bool deps_match(char* deps_path, char* gltf_path) {
+    if (!file_exists(deps_path)) {
+        return false;
+    }
+
+    size_t size = 0;
+    char* text = load_file(deps_path, &size);
+
+    size_t header_len = strlen(GLTF_DEPS_HEADER);
+    bool match = size >= header_len && memcmp(text, GLTF_DEPS_HEADER, header_len) == 0;
+
+    char* line = text + header_len;
+
+    while (match && *line) {
+        char* newline = strchr(line, '\n');
+        if (!newline) {
+            match = false;
+            break;
+        }
+        *newline = '\0';
+
+        char* dep_path = strchr(line, ' ');
+        if (!dep_path) {
+            match = false;
+            break;
+        }
+        *dep_path++ = '\0';
+
+        uint64_t expected = strtoull(line, NULL, 16);
+
+        char full_path[1024];
+        snprintf(full_path, sizeof(full_path), "%.*s%s", (int)path_dir_len(gltf_path), gltf_path, dep_path);
+        match = file_exists(full_path) && hash_file(full_path) == expected;
+
+        line = newline + 1;
+    }
+
+    free(text);
+
+    return match;
+}
+
+static bool write_deps(char* deps_path, char* gltf_path, GltfDeps* deps) {
+    size_t gltf_dir_len = path_dir_len(gltf_path);
+
+    size_t cap = strlen(GLTF_DEPS_HEADER) + 1;
+    for (int i = 0; i < deps->count; ++i) {
+        cap += strlen(deps->paths[i]) + 19;
+    }
+
+    char* text = (char*)malloc(cap);
+    size_t len = (size_t)snprintf(text, cap, "%s", GLTF_DEPS_HEADER);
+
+    for (int i = 0; i < deps->count; ++i) {
+        len += (size_t)snprintf(text + len, cap - len, "%016llx %s\n", (unsigned long long)deps->hashes[i], deps->paths[i] + gltf_dir_len);
+    }
+
+    bool ok = write_file(deps_path, text, len);
+    free(text);
+
+    return ok;
+}
+
+struct GltfCacheWriter {
+    GltfMeshProc* proc;
+    void* user;
+    MeshBlobBuilder* builder;
+};
+
+static void cache_mesh(void* user, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    GltfCacheWriter* writer = (GltfCacheWriter*)user;
+    mesh_blob_add(writer->builder, vertex_data, vertex_count, index_data, index_count);
+    writer->proc(writer->user, vertex_data, vertex_count, index_data, index_count);
+}
+
+void load_gltf_cached(JobSystem* js, char* path, char* cache_dir, GltfMeshProc* proc, void* user, GltfStats* o_stats) {
+    float start_time = engine_time();
+
+    uint64_t seed = ((uint64_t)GLTF_LOADER_VERSION << 32) | MESH_BLOB_VERSION;
+    uint64_t key = hash64(&seed, sizeof(seed), hash_file(path));
+
+    // External buffers resolve against the glTF's directory, so identical glTFs in different places
+    // get separate entries instead of evicting each other.
+    key = hash64(path, path_dir_len(path), key);
+
+    char blob_path[1024];
+    char deps_path[1024];
+    snprintf(blob_path, sizeof(blob_path), "%s/%016llx.mesh", cache_dir, (unsigned long long)key);
+    snprintf(deps_path, sizeof(deps_path), "%s/%016llx.deps", cache_dir, (unsigned long long)key);
+
+    MeshBlob* blob = deps_match(deps_path, path) ? mesh_blob_open(blob_path) : NULL;
+
+    if (blob) {
+        float open_done_time = engine_time();
+
+        for (uint32_t i = 0; i < mesh_blob_count(blob); ++i) {
+            MeshBlobMesh mesh = mesh_blob_mesh(blob, i);
+            proc(user, mesh.vertices, mesh.vertex_count, mesh.indices, mesh.index_count);
+        }
+
+        mesh_blob_close(blob);
+
+        if (o_stats) {
+            memset(o_stats, 0, sizeof(GltfStats));
+            o_stats->cache_hit = true;
+            o_stats->map_time = open_done_time - start_time;
+            o_stats->mesh_time = engine_time() - open_done_time;
+        }
+
+        return;
+    }
+
+    GltfCacheWriter writer;
+    writer.proc = proc;
+    writer.user = user;
+    writer.builder = mesh_blob_builder_create();
+
+    GltfDeps deps = {};
+    load_gltf_source(js, path, cache_mesh, &writer, o_stats, &deps);
+
+    size_t blob_size = 0;
+    void* blob_data = mesh_blob_build(writer.builder, &blob_size);
+
+    // A failed write only costs the next load a cache miss.
+    if (create_directory(cache_dir) && write_deps(deps_path, path, &deps)) {
+        write_file(blob_path, blob_data, blob_size);
+    }
+
+    free(blob_data);
+    mesh_blob_builder_free(writer.builder);
+    free_deps(&deps);
+}
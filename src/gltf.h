@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+#include "renderer.h"
+#include "jobs.h"
+#include "mesh_opt.h"
+
+// Called once per primitive, after the primitive has been through optimize_mesh. The vertex and index data are only valid for the duration of the call.
+typedef void GltfMeshProc(void* user, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count);
+
+// Seconds spent in each stage of load_gltf. buffer_wait_time is how long buffer loads outlasted parsing and view and accessor resolution.
+// On a cache hit, map_time covers hashing the source and opening the cached meshes.
+struct GltfStats {
+    float map_time;
+    float parse_time;
+    float resolve_time;
+    float buffer_wait_time;
+    float mesh_time;
+    bool cache_hit;
+
+    // Primitives dropped instead of handed to proc: points, lines, or triangles with an invalid index count
+    // or indices past the end of the vertex data.
+    uint32_t skipped_primitives;
+
+    // Post-transform cache statistics summed over every primitive, before and after optimize_mesh.
+    // Zero on a cache hit, since cached meshes are stored already optimized.
+    MeshOptStats opt_before;
+    MeshOptStats opt_after;
+};
+
+// Loads a .gltf or .glb file and hands each primitive to proc on the calling thread, which must be a worker of js.
+// o_stats may be NULL.
+void load_gltf(JobSystem* js, char* path, GltfMeshProc* proc, void* user, GltfStats* o_stats);
+
+// Like load_gltf, but keyed by a hash of the file contents and loader version, reuses meshes converted
+// by an earlier load from cache_dir. Misses, including changed external buffers, fall back to load_gltf and refill the cache.
+void load_gltf_cached(JobSystem* js, char* path, char* cache_dir, GltfMeshProc* proc, void* user, GltfStats* o_stats);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "common.h"
+
+// XXH64: fast non-cryptographic 64-bit hash, for content-addressing files.
+uint64_t hash64(void* data, size_t len, uint64_t seed);
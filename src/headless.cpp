@@ -0,0 +1,1477 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "gltf.h"
+#include "json.h"
+#include "jobs.h"
+#include "mesh_blob.h"
+#include "renderer_soft.h"
+#include "mesh_pool.h"
+#include "descriptor_alloc.h"
+#include "buffer_heap.h"
+#include "upload_ring.h"
+#include "base64.h"
+
+struct MeshTotals {
+    uint32_t mesh_count;
+    uint64_t vertex_count;
+    uint64_t index_count;
+};
+
+static void count_mesh(void* user, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    UNUSED(vertex_data);
+    UNUSED(index_data);
+
+    MeshTotals* totals = (MeshTotals*)user;
+    totals->mesh_count++;
+    totals->vertex_count += vertex_count;
+    totals->index_count += index_count;
+}
+
+static void empty_job(void* arg) {
+    UNUSED(arg);
+}
+
+struct ScalingWork {
+    float* data;
+    float* sums;
+};
+
+static void scaling_kernel(void* arg, uint32_t begin, uint32_t end) {
+    ScalingWork* work = (ScalingWork*)arg;
+
+    float sum = 0.0f;
+    for (uint32_t i = begin; i < end; ++i) {
+        sum += sqrtf(work->data[i]) * sinf(work->data[i]);
+    }
+
+    work->sums[begin / 4096] = sum;
+}
+
+// Spawn overhead of empty jobs and parallel_for scaling on a compute-bound loop, for each thread count up to cpu_count().
+static void bench_jobs() {
+    uint32_t item_count = 1 << 24;
+
+    ScalingWork work;
+    work.data = (float*)malloc(item_count * sizeof(float));
+    work.sums = (float*)calloc(item_count / 4096, sizeof(float));
+
+    for (uint32_t i = 0; i < item_count; ++i) {
+        work.data[i] = (float)(i % 1000) * 0.001f;
+    }
+
+    float single_thread_time = 0.0f;
+
+    for (int thread_count = 1; thread_count <= cpu_count(); thread_count *= 2) {
+        JobSystem* js = jobs_init(thread_count);
+
+        int rounds = 100;
+        int jobs_per_round = 1000;
+
+        float start = engine_time();
+
+        for (int r = 0; r < rounds; ++r) {
+            JobCounter counter = {};
+            for (int i = 0; i < jobs_per_round; ++i) {
+                jobs_run(js, empty_job, NULL, &counter);
+            }
+            jobs_wait(js, &counter);
+        }
+
+        float spawn_time = engine_time() - start;
+
+        start = engine_time();
+        parallel_for(js, item_count, 4096, scaling_kernel, &work);
+        float for_time = engine_time() - start;
+
+        if (thread_count == 1) {
+            single_thread_time = for_time;
+        }
+
+        printf("%2d threads | spawn+run %7.1f ns/job | parallel_for %8.3f ms (%.2fx)\n",
+               thread_count, spawn_time * 1e9f / (float)(rounds * jobs_per_round),
+               for_time * 1000.0f, single_thread_time / for_time);
+
+        jobs_free(js);
+    }
+
+    free(work.sums);
+    free(work.data);
+}
+
+static void print_opt_stats(MeshOptStats before, MeshOptStats after) {
+    printf("vertex cache (FIFO %d): acmr %.3f -> %.3f | atvr %.3f -> %.3f\n", MESH_OPT_FIFO_SIZE,
+           mesh_opt_acmr(before), mesh_opt_acmr(after), mesh_opt_atvr(before), mesh_opt_atvr(after));
+}
+
+// Opening a cooked file, plus one pass over its data so the page-ins are counted too.
+static void bench_mesh_blob(char* path, int iterations) {
+    for (int i = 0; i < iterations; ++i) {
+        float start = engine_time();
+
+        MeshBlob* blob = mesh_blob_open(path);
+        if (!blob) {
+            fprintf(stderr, "%s is not a valid cooked mesh file\n", path);
+            return;
+        }
+
+        float open_time = engine_time() - start;
+
+        MeshTotals totals = {};
+        uint32_t checksum = 0;
+
+        for (uint32_t m = 0; m < mesh_blob_count(blob); ++m) {
+            MeshBlobMesh mesh = mesh_blob_mesh(blob, m);
+            count_mesh(&totals, mesh.vertices, mesh.vertex_count, mesh.indices, mesh.index_count);
+
+            for (uint32_t k = 0; k < mesh.index_count; ++k) {
+                checksum += mesh.indices[k];
+            }
+        }
+
+        float total = engine_time() - start;
+
+        mesh_blob_close(blob);
+
+        if (i == 0) {
+            printf("%s: %u meshes, %llu vertices, %llu indices (index sum %u)\n", path, totals.mesh_count,
+                   (unsigned long long)totals.vertex_count, (unsigned long long)totals.index_count, checksum);
+        }
+
+        printf("open %8.3f ms | total %8.3f ms\n", open_time * 1000.0f, total * 1000.0f);
+    }
+}
+
+static void add_render_mesh(void* user, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    rd_add_mesh((Renderer*)user, vertex_data, vertex_count, index_data, index_count);
+}
+
+static bool write_ppm(char* path, uint32_t* pixels, uint32_t width, uint32_t height, uint32_t pitch) {
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+
+    size_t size = (size_t)header_len + (size_t)width * height * 3;
+    uint8_t* data = (uint8_t*)malloc(size);
+    memcpy(data, header, header_len);
+
+    uint8_t* out = data + header_len;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint32_t p = pixels[y * pitch + x];
+            *out++ = (uint8_t)p;
+            *out++ = (uint8_t)(p >> 8);
+            *out++ = (uint8_t)(p >> 16);
+        }
+    }
+
+    bool ok = write_file(path, data, size);
+    free(data);
+
+    return ok;
+}
+
+// Frames and triangles per second of the software renderer at 1280x720, over frame_count frames of the animated camera.
+static void bench_render(char* path, int frame_count, char* ppm_path) {
+    JobSystem* js = jobs_init(cpu_count());
+
+    RDSoftDesc desc = {};
+    desc.width = 1280;
+    desc.height = 720;
+    desc.js = js;
+
+    Renderer* r = rd_init(&desc);
+    load_gltf(js, path, add_render_mesh, r, NULL);
+
+    // The first frame sizes the bins, so it isn't timed.
+    rd_soft_set_time(r, 0.0f);
+    rd_render(r);
+
+    RDSoftStats totals = {};
+    float start = engine_time();
+
+    for (int i = 0; i < frame_count; ++i) {
+        rd_soft_set_time(r, (float)i / 60.0f);
+        rd_render(r);
+
+        RDSoftStats stats;
+        rd_soft_stats(r, &stats);
+        totals.triangle_count += stats.triangle_count;
+        totals.visible_triangle_count += stats.visible_triangle_count;
+        totals.transform_time += stats.transform_time;
+        totals.bin_time += stats.bin_time;
+        totals.raster_time += stats.raster_time;
+    }
+
+    float total = engine_time() - start;
+    float frames = (float)frame_count;
+
+    printf("%s: %u triangles, %u visible, %ux%u, %d threads\n", path, totals.triangle_count / frame_count,
+           totals.visible_triangle_count / frame_count, desc.width, desc.height, jobs_thread_count(js));
+    printf("%8.1f fps | %8.2f Mtri/s | transform %7.3f ms | bin %7.3f ms | raster %7.3f ms\n",
+           frames / total, (float)totals.triangle_count / total * 1e-6f,
+           totals.transform_time / frames * 1000.0f, totals.bin_time / frames * 1000.0f, totals.raster_time / frames * 1000.0f);
+
+    if (ppm_path) {
+        uint32_t width, height, pitch;
+        uint32_t* pixels = rd_soft_pixels(r, &width, &height, &pitch);
+
+        if (!write_ppm(ppm_path, pixels, width, height, pitch)) {
+            fprintf(stderr, "failed writing %s\n", ppm_path);
+        }
+    }
+
+    rd_free(r);
+    jobs_free(js);
+}
+
+struct PoolTestItem {
+    uint32_t tag;
+};
+
+struct DescriptorTestAlloc {
+    uint32_t first;
+    uint32_t count;
+    uint32_t tag;
+};
+
+struct DescriptorTestPending {
+    DescriptorTestAlloc alloc;
+    uint64_t fence;
+};
+
+// A frame's frees and allocations in order, replayed against the shadow owners once the frame is timed.
+struct DescriptorTestEvent {
+    DescriptorTestAlloc alloc;
+    bool freed;
+};
+
+struct BufferTestPending {
+    BufferAlloc alloc;
+    uint64_t fence;
+};
+
+// Fence is 0 until the allocation is submitted.
+struct RingTestAlloc {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t fence;
+};
+
+struct RingTest {
+    UploadRing* ring;
+    uint8_t* owned; // Per 16 bytes of the ring.
+
+    RingTestAlloc* allocs;
+    uint32_t alloc_count;
+    uint32_t alloc_cap;
+
+    uint64_t next_fence;
+    uint64_t completed_fence;
+    uint64_t stalls;
+    uint64_t wrap_padding;
+};
+
+static uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Streams meshes through a pool of live_count under a simulated frame fence: every frame replaces a tenth of
+// them and walks the live list, and slots retire two frames late, as a GPU would hold them.
+// Asserts that removed handles go stale and live ones keep resolving to their own item.
+static void bench_mesh_pool(uint32_t live_count, int frame_count) {
+    MeshPool* pool = mesh_pool_create(sizeof(PoolTestItem));
+    RDMesh* handles = (RDMesh*)malloc(live_count * sizeof(RDMesh));
+    uint32_t* tags = (uint32_t*)malloc(live_count * sizeof(uint32_t));
+
+    uint32_t rng = 0x9E3779B9;
+    uint32_t next_tag = 1;
+
+    for (uint32_t i = 0; i < live_count; ++i) {
+        PoolTestItem* item = NULL;
+        handles[i] = mesh_pool_add(pool, (void**)&item);
+        item->tag = tags[i] = next_tag++;
+    }
+
+    uint32_t churn = live_count / 10 ? live_count / 10 : 1;
+    RDMesh* stale = (RDMesh*)malloc(churn * sizeof(RDMesh));
+
+    uint64_t ops = 0;
+    uint64_t walked = 0;
+    uint64_t walk_sum = 0;
+    float churn_time = 0.0f;
+    float walk_time = 0.0f;
+
+    uint32_t expected_sum = 0;
+    for (uint32_t i = 0; i < live_count; ++i) {
+        expected_sum += tags[i];
+    }
+
+    for (int frame = 1; frame <= frame_count; ++frame) {
+        float start = engine_time();
+
+        for (uint32_t k = 0; k < churn; ++k) {
+            uint32_t i = xorshift32(&rng) % live_count;
+
+            stale[k] = handles[i];
+            bool removed = mesh_pool_remove(pool, handles[i], (uint64_t)frame);
+            assert(removed);
+            UNUSED(removed);
+
+            PoolTestItem* item = NULL;
+            handles[i] = mesh_pool_add(pool, (void**)&item);
+            item->tag = next_tag;
+
+            expected_sum += next_tag - tags[i];
+            tags[i] = next_tag++;
+
+            ops += 2;
+        }
+
+        if (frame > 2) {
+            mesh_pool_retire(pool, (uint64_t)frame - 2, NULL, NULL);
+        }
+
+        float churned = engine_time();
+
+        uint32_t tag_sum = 0;
+        for (uint32_t i = 0; i < mesh_pool_count(pool); ++i) {
+            tag_sum += ((PoolTestItem*)mesh_pool_item(pool, i))->tag;
+        }
+        walked += mesh_pool_count(pool);
+
+        float walk_done = engine_time();
+
+        churn_time += churned - start;
+        walk_time += walk_done - churned;
+
+        // The sum is checked and printed, so the walk can't be optimized away.
+        assert(tag_sum == expected_sum);
+        walk_sum += tag_sum;
+
+        for (uint32_t k = 0; k < churn; ++k) {
+            assert(!mesh_pool_get(pool, stale[k]));
+            assert(!mesh_pool_remove(pool, stale[k], (uint64_t)frame));
+        }
+
+        assert(mesh_pool_count(pool) == live_count);
+    }
+
+    for (uint32_t i = 0; i < live_count; ++i) {
+        PoolTestItem* item = (PoolTestItem*)mesh_pool_get(pool, handles[i]);
+        assert(item && item->tag == tags[i]);
+        UNUSED(item);
+    }
+
+    printf("%u live meshes, %d frames: %u slots | %.1f ns per add/remove | %.2f ns per live mesh walked (tag sum %llu)\n",
+           live_count, frame_count, mesh_pool_slot_count(pool), churn_time * 1e9f / (float)ops, walk_time * 1e9f / (float)walked,
+           (unsigned long long)walk_sum);
+
+    free(stale);
+    free(tags);
+    free(handles);
+    mesh_pool_free(pool);
+}
+
+static bool descriptor_test_alloc(DescriptorAllocator* a, uint32_t* owners, DescriptorTestAlloc* o_alloc, uint32_t count, uint32_t tag) {
+    uint32_t first = descriptor_alloc(a, count);
+    if (first == DESCRIPTOR_INVALID) {
+        o_alloc->count = 0;
+        return false;
+    }
+
+    for (uint32_t i = first; i < first + count; ++i) {
+        assert(owners[i] == 0);
+        owners[i] = tag;
+    }
+
+    o_alloc->first = first;
+    o_alloc->count = count;
+    o_alloc->tag = tag;
+
+    return true;
+}
+
+// Churns a descriptor heap of the given capacity under a simulated frame fence: a sixteenth of the heap is held
+// in allocations, mostly single views with some ranges, and a tenth of them are replaced each frame.
+// Frees are deferred on the frame's fence and retire two frames late. A shadow owner per slot asserts that no
+// slot is handed out twice, including ones still pending, and draining everything must coalesce back.
+static void bench_descriptors(uint32_t capacity, int frame_count) {
+    DescriptorAllocator* a = descriptor_allocator_create(capacity);
+
+    uint32_t live_count = capacity / 16 ? capacity / 16 : 1;
+    DescriptorTestAlloc* live = (DescriptorTestAlloc*)calloc(live_count, sizeof(DescriptorTestAlloc));
+    uint32_t* owners = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+
+    uint32_t pending_cap = 64;
+    uint32_t pending_count = 0;
+    DescriptorTestPending* pending = (DescriptorTestPending*)malloc(pending_cap * sizeof(DescriptorTestPending));
+
+    uint32_t rng = 0x9E3779B9;
+    uint32_t next_tag = 1;
+    uint64_t ops = 0;
+    uint64_t failures = 0;
+
+    for (uint32_t i = 0; i < live_count; ++i) {
+        uint32_t count = xorshift32(&rng) % 8 ? 1 : 2 + xorshift32(&rng) % 63;
+        failures += !descriptor_test_alloc(a, owners, live + i, count, next_tag++);
+    }
+
+    uint32_t churn = live_count / 10 ? live_count / 10 : 1;
+    float worst_fragmentation = 0.0f;
+    float alloc_time = 0.0f;
+
+    DescriptorTestEvent* events = (DescriptorTestEvent*)malloc(churn * 2 * sizeof(DescriptorTestEvent));
+
+    for (int frame = 1; frame <= frame_count; ++frame) {
+        uint32_t event_count = 0;
+
+        float start = engine_time();
+
+        if (frame > 2) {
+            descriptor_retire(a, (uint64_t)frame - 2);
+        }
+
+        for (uint32_t k = 0; k < churn; ++k) {
+            DescriptorTestAlloc* slot = live + xorshift32(&rng) % live_count;
+
+            if (slot->count) {
+                descriptor_free_deferred(a, slot->first, (uint64_t)frame);
+                events[event_count].alloc = *slot;
+                events[event_count].freed = true;
+                ++event_count;
+            }
+
+            uint32_t count = xorshift32(&rng) % 8 ? 1 : 2 + xorshift32(&rng) % 63;
+            uint32_t first = descriptor_alloc(a, count);
+
+            slot->first = first;
+            slot->count = first == DESCRIPTOR_INVALID ? 0 : count;
+            slot->tag = next_tag++;
+            failures += first == DESCRIPTOR_INVALID;
+
+            events[event_count].alloc = *slot;
+            events[event_count].freed = false;
+            ++event_count;
+
+            ops += 2;
+        }
+
+        alloc_time += engine_time() - start;
+
+        if (frame > 2) {
+            uint64_t completed = (uint64_t)frame - 2;
+
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < pending_count; ++i) {
+                DescriptorTestPending p = pending[i];
+                if (p.fence <= completed) {
+                    for (uint32_t j = p.alloc.first; j < p.alloc.first + p.alloc.count; ++j) {
+                        assert(owners[j] == p.alloc.tag);
+                        owners[j] = 0;
+                    }
+                }
+                else {
+                    pending[kept++] = p;
+                }
+            }
+            pending_count = kept;
+        }
+
+        for (uint32_t i = 0; i < event_count; ++i) {
+            DescriptorTestAlloc e = events[i].alloc;
+
+            if (events[i].freed) {
+                if (pending_count == pending_cap) {
+                    pending_cap *= 2;
+                    pending = (DescriptorTestPending*)realloc(pending, pending_cap * sizeof(DescriptorTestPending));
+                }
+
+                pending[pending_count].alloc = e;
+                pending[pending_count].fence = (uint64_t)frame;
+                ++pending_count;
+            }
+            else {
+                for (uint32_t j = e.first; j < e.first + e.count; ++j) {
+                    assert(owners[j] == 0);
+                    owners[j] = e.tag;
+                }
+            }
+        }
+
+        DescriptorStats stats;
+        descriptor_stats(a, &stats);
+        if (stats.fragmentation > worst_fragmentation) {
+            worst_fragmentation = stats.fragmentation;
+        }
+    }
+
+    free(events);
+
+    DescriptorStats stats;
+    descriptor_stats(a, &stats);
+
+    printf("capacity %u, %u live allocations, %d frames: %.1f ns per alloc/free | %u failures\n",
+           capacity, live_count, frame_count, alloc_time * 1e9f / (float)ops, (uint32_t)failures);
+    printf("used %u | reserved %u | pending %u | peak %u | %u free blocks, largest %u | fragmentation %.3f, worst %.3f\n",
+           stats.used, stats.reserved, stats.pending, stats.peak, stats.free_blocks, stats.largest_free, stats.fragmentation, worst_fragmentation);
+
+    for (uint32_t i = 0; i < live_count; ++i) {
+        if (live[i].count) {
+            descriptor_free(a, live[i].first);
+        }
+    }
+    descriptor_retire(a, UINT64_MAX);
+
+    descriptor_stats(a, &stats);
+    assert(stats.used == 0 && stats.reserved == 0 && stats.pending == 0);
+    assert((capacity & (capacity - 1)) || (stats.free_blocks == 1 && stats.largest_free == capacity));
+
+    free(pending);
+    free(owners);
+    free(live);
+    descriptor_allocator_free(a);
+}
+
+static void count_heap_block(void* user, uint32_t block, uint32_t size) {
+    uint32_t* block_count = (uint32_t*)user;
+    assert(block == *block_count && size > 0);
+    UNUSED(block);
+    UNUSED(size);
+    ++*block_count;
+}
+
+static int compare_buffer_allocs(const void* a, const void* b) {
+    const BufferAlloc* x = (const BufferAlloc*)a;
+    const BufferAlloc* y = (const BufferAlloc*)b;
+
+    if (x->block != y->block) {
+        return x->block < y->block ? -1 : 1;
+    }
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+// Sizes spread evenly over powers of two from 64 bytes to 512 KB, like a mix of small props and large meshes.
+static uint32_t random_buffer_size(uint32_t* rng) {
+    uint32_t base = 64u << (xorshift32(rng) % 13);
+    return base + xorshift32(rng) % base;
+}
+
+// Requests around and past the block size, which get blocks of their own, keeping their alignment.
+static void test_buffer_heap_oversize() {
+    uint32_t block_size = 64 << 20;
+    uint32_t sizes[] = { block_size - 16, block_size, block_size + 1, block_size * 3 + 5 };
+    uint32_t alignments[] = { 16, sizeof(RDMeshVertex), 256 };
+
+    uint32_t block_count = 0;
+    BufferHeap* heap = buffer_heap_create(block_size, count_heap_block, &block_count);
+
+    for (uint32_t i = 0; i < ARR_LEN(sizes); ++i) {
+        for (uint32_t j = 0; j < ARR_LEN(alignments); ++j) {
+            BufferAlloc small = buffer_heap_alloc(heap, 4096, alignments[j]);
+            BufferAlloc big = buffer_heap_alloc(heap, sizes[i], alignments[j]);
+
+            assert(big.size >= sizes[i] && (big.offset & (alignments[j] - 1)) == 0);
+            assert(big.block != small.block || big.offset >= small.offset + small.size || small.offset >= big.offset + big.size);
+
+            buffer_heap_release(heap, big);
+            buffer_heap_release(heap, small);
+        }
+    }
+
+    BufferHeapStats stats;
+    buffer_heap_stats(heap, &stats);
+    assert(stats.alloc_count == 0 && stats.free_ranges == stats.block_count);
+
+    buffer_heap_free(heap);
+}
+
+// Streams live_count mesh-sized buffers through 64 MB blocks under a simulated frame fence: a tenth are replaced
+// each frame and released two frames late. Every 64 frames the live and pending ranges are sorted and checked
+// for overlap and alignment, and draining everything must merge each block back into one free range.
+static void bench_buffer_heap(uint32_t live_count, int frame_count) {
+    test_buffer_heap_oversize();
+
+    uint32_t block_count = 0;
+    BufferHeap* heap = buffer_heap_create(64 << 20, count_heap_block, &block_count);
+
+    BufferAlloc* live = (BufferAlloc*)malloc(live_count * sizeof(BufferAlloc));
+    uint32_t* alignments = (uint32_t*)malloc(live_count * sizeof(uint32_t));
+
+    uint32_t pending_cap = 64;
+    uint32_t pending_count = 0;
+    BufferTestPending* pending = (BufferTestPending*)malloc(pending_cap * sizeof(BufferTestPending));
+
+    BufferAlloc* check = NULL;
+    uint32_t check_cap = 0;
+
+    uint32_t rng = 0x9E3779B9;
+
+    for (uint32_t i = 0; i < live_count; ++i) {
+        alignments[i] = xorshift32(&rng) % 4 ? sizeof(RDMeshVertex) : 256;
+        live[i] = buffer_heap_alloc(heap, random_buffer_size(&rng), alignments[i]);
+    }
+
+    uint32_t churn = live_count / 10 ? live_count / 10 : 1;
+    uint64_t ops = 0;
+    float worst_fragmentation = 0.0f;
+    float alloc_time = 0.0f;
+
+    for (int frame = 1; frame <= frame_count; ++frame) {
+        float start = engine_time();
+
+        if (frame > 2) {
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < pending_count; ++i) {
+                if (pending[i].fence <= (uint64_t)frame - 2) {
+                    buffer_heap_release(heap, pending[i].alloc);
+                    ++ops;
+                }
+                else {
+                    pending[kept++] = pending[i];
+                }
+            }
+            pending_count = kept;
+        }
+
+        for (uint32_t k = 0; k < churn; ++k) {
+            uint32_t i = xorshift32(&rng) % live_count;
+
+            if (pending_count == pending_cap) {
+                pending_cap *= 2;
+                pending = (BufferTestPending*)realloc(pending, pending_cap * sizeof(BufferTestPending));
+            }
+
+            pending[pending_count].alloc = live[i];
+            pending[pending_count].fence = (uint64_t)frame;
+            ++pending_count;
+
+            alignments[i] = xorshift32(&rng) % 4 ? sizeof(RDMeshVertex) : 256;
+            live[i] = buffer_heap_alloc(heap, random_buffer_size(&rng), alignments[i]);
+            ++ops;
+        }
+
+        alloc_time += engine_time() - start;
+
+        for (uint32_t i = 0; i < live_count; ++i) {
+            assert((live[i].offset & (alignments[i] - 1)) == 0);
+        }
+
+        if (frame % 64 == 0 || frame == frame_count) {
+            uint32_t n = live_count + pending_count;
+            if (n > check_cap) {
+                check_cap = n * 2;
+                check = (BufferAlloc*)realloc(check, check_cap * sizeof(BufferAlloc));
+            }
+
+            memcpy(check, live, live_count * sizeof(BufferAlloc));
+            for (uint32_t i = 0; i < pending_count; ++i) {
+                check[live_count + i] = pending[i].alloc;
+            }
+
+            qsort(check, n, sizeof(BufferAlloc), compare_buffer_allocs);
+
+            for (uint32_t i = 1; i < n; ++i) {
+                assert(check[i - 1].block != check[i].block || check[i - 1].offset + check[i - 1].size <= check[i].offset);
+            }
+
+            BufferHeapStats stats;
+            buffer_heap_stats(heap, &stats);
+            if (stats.fragmentation > worst_fragmentation) {
+                worst_fragmentation = stats.fragmentation;
+            }
+        }
+    }
+
+    BufferHeapStats stats;
+    buffer_heap_stats(heap, &stats);
+    assert(stats.block_count == block_count);
+
+    printf("%u live buffers, %d frames: %.1f ns per alloc/release\n", live_count, frame_count, alloc_time * 1e9f / (float)ops);
+    printf("%u blocks, %.1f MB reserved | %.1f MB used, peak %.1f MB | %u free ranges, largest %.1f MB | fragmentation %.3f, worst %.3f\n",
+           stats.block_count, (double)stats.reserved / (1 << 20), (double)stats.used / (1 << 20), (double)stats.peak_used / (1 << 20),
+           stats.free_ranges, (double)stats.largest_free / (1 << 20), stats.fragmentation, worst_fragmentation);
+
+    for (uint32_t i = 0; i < live_count; ++i) {
+        buffer_heap_release(heap, live[i]);
+    }
+    for (uint32_t i = 0; i < pending_count; ++i) {
+        buffer_heap_release(heap, pending[i].alloc);
+    }
+
+    buffer_heap_stats(heap, &stats);
+    assert(stats.alloc_count == 0 && stats.used == 0 && stats.free_ranges == stats.block_count);
+
+    free(check);
+    free(pending);
+    free(alignments);
+    free(live);
+    buffer_heap_free(heap);
+}
+
+static void ring_test_retire(RingTest* t, uint64_t completed_fence) {
+    t->completed_fence = completed_fence;
+    upload_ring_retire(t->ring, completed_fence);
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < t->alloc_count; ++i) {
+        RingTestAlloc a = t->allocs[i];
+        if (a.fence && a.fence <= completed_fence) {
+            memset(t->owned + a.offset / 16, 0, (a.size + 15) / 16);
+        }
+        else {
+            t->allocs[kept++] = a;
+        }
+    }
+    t->alloc_count = kept;
+}
+
+static void ring_test_submit(RingTest* t) {
+    uint64_t fence = ++t->next_fence;
+    upload_ring_submit(t->ring, fence);
+
+    for (uint32_t i = 0; i < t->alloc_count; ++i) {
+        if (!t->allocs[i].fence) {
+            t->allocs[i].fence = fence;
+        }
+    }
+}
+
+// On a full ring, submits what's pending and stalls on the oldest fence, as the renderer does.
+static void ring_test_alloc(RingTest* t, uint64_t size, uint64_t alignment) {
+    uint64_t offset;
+    while ((offset = upload_ring_alloc(t->ring, size, alignment)) == UPLOAD_RING_FULL) {
+        if (!upload_ring_oldest_fence(t->ring)) {
+            ring_test_submit(t);
+        }
+        ring_test_retire(t, upload_ring_oldest_fence(t->ring));
+        ++t->stalls;
+    }
+
+    UploadRingStats stats;
+    upload_ring_stats(t->ring, &stats);
+    assert((offset & (alignment - 1)) == 0 && offset + size <= stats.capacity);
+    assert(stats.wrap_padding >= t->wrap_padding);
+    t->wrap_padding = stats.wrap_padding;
+
+    for (uint64_t i = offset / 16; i < (offset + size + 15) / 16; ++i) {
+        assert(!t->owned[i]);
+        t->owned[i] = 1;
+    }
+
+    if (t->alloc_count == t->alloc_cap) {
+        t->alloc_cap = t->alloc_cap ? t->alloc_cap * 2 : 256;
+        t->allocs = (RingTestAlloc*)realloc(t->allocs, t->alloc_cap * sizeof(RingTestAlloc));
+    }
+
+    RingTestAlloc* a = t->allocs + t->alloc_count++;
+    a->offset = offset;
+    a->size = size;
+    a->fence = 0;
+}
+
+// Drives an upload ring against a simulated fence timeline. Each frame allocates hundreds of 256-byte constant
+// blocks and a few staging copies of up to 256 KB or half the ring, then makes one to three submissions, while the simulated GPU
+// completes up to three submissions behind. A byte owner map asserts that no allocation reuses space before
+// its fence completes. Capacities that aren't a multiple of 256 exercise aligned offsets rounding past the end.
+static void bench_upload_ring(uint64_t capacity, int frame_count) {
+    assert(capacity >= 4096);
+    uint64_t max_staging = capacity / 2 < (256 << 10) ? capacity / 2 : (256 << 10);
+
+    RingTest t = {};
+    t.ring = upload_ring_create(capacity);
+    t.owned = (uint8_t*)calloc((capacity + 15) / 16, 1);
+
+    uint32_t rng = 0x9E3779B9;
+    uint64_t alloc_count = 0;
+    uint64_t bytes = 0;
+
+    float start = engine_time();
+
+    for (int frame = 1; frame <= frame_count; ++frame) {
+        uint32_t constant_count = 50 + xorshift32(&rng) % 250;
+        uint32_t staging_count = xorshift32(&rng) % 4;
+
+        for (uint32_t i = 0; i < constant_count + staging_count; ++i) {
+            uint64_t size = i < constant_count ? 256 : 1024 + xorshift32(&rng) % (max_staging - 1024);
+            uint64_t alignment = i < constant_count ? 256 : 16;
+
+            ring_test_alloc(&t, size, alignment);
+
+            ++alloc_count;
+            bytes += size;
+        }
+
+        uint32_t submit_count = 1 + xorshift32(&rng) % 3;
+        for (uint32_t i = 0; i < submit_count; ++i) {
+            ring_test_submit(&t);
+        }
+
+        uint64_t lag = xorshift32(&rng) % 4;
+        if (t.next_fence > lag && t.next_fence - lag > t.completed_fence) {
+            ring_test_retire(&t, t.next_fence - lag);
+        }
+    }
+
+    float total = engine_time() - start;
+
+    ring_test_retire(&t, t.next_fence);
+
+    UploadRingStats stats;
+    upload_ring_stats(t.ring, &stats);
+    assert(stats.used == 0 && stats.pending_submissions == 0 && t.alloc_count == 0);
+
+    printf("%d frames, %llu allocations, %.1f MB: %.1f ns per allocation (including checks) | %llu stalls\n",
+           frame_count, (unsigned long long)alloc_count, (double)bytes / (1 << 20), total * 1e9f / (float)alloc_count, (unsigned long long)t.stalls);
+    printf("peak %.2f of %.2f MB | %.2f MB wrap padding\n",
+           (double)stats.peak_used / (1 << 20), (double)stats.capacity / (1 << 20), (double)stats.wrap_padding / (1 << 20));
+
+    free(t.allocs);
+    free(t.owned);
+    upload_ring_free(t.ring);
+}
+
+static const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t base64_encode(uint8_t* in, size_t len, char* out) {
+    size_t o = 0;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t b1 = i + 1 < len ? in[i + 1] : 0;
+        uint32_t b2 = i + 2 < len ? in[i + 2] : 0;
+        uint32_t v = ((uint32_t)in[i] << 16) | (b1 << 8) | b2;
+
+        out[o++] = base64_alphabet[(v >> 18) & 63];
+        out[o++] = base64_alphabet[(v >> 12) & 63];
+        out[o++] = i + 1 < len ? base64_alphabet[(v >> 6) & 63] : '=';
+        out[o++] = i + 2 < len ? base64_alphabet[v & 63] : '=';
+    }
+
+    return o;
+}
+
+// Decodes with both the dispatching and the scalar decoder and counts a failure unless both agree with expect,
+// or both reject the input when expect is NULL.
+static void base64_check(char* in, size_t len, size_t out_max, uint8_t* expect, size_t expect_len, uint32_t* failures) {
+    uint8_t* out = (uint8_t*)malloc(out_max + 1);
+
+    for (int scalar = 0; scalar < 2; ++scalar) {
+        size_t out_len = 0;
+        bool ok = scalar ? base64_decode_scalar(in, len, out, out_max, &out_len) : base64_decode(in, len, out, out_max, &out_len);
+
+        bool pass = expect ? ok && out_len == expect_len && memcmp(out, expect, expect_len) == 0 : !ok;
+        if (!pass) {
+            fprintf(stderr, "base64: %s decoder %s %zu characters (out_max %zu)\n", scalar ? "scalar" : "vector", ok ? "accepted" : "rejected", len, out_max);
+            ++*failures;
+        }
+    }
+
+    free(out);
+}
+
+// Round-trips every input length up to a few vector widths, so each tail of 0-2 data bytes lands on and around
+// the 16- and 32-character steps, then corrupts each position and the padding. Times both decoders on size bytes.
+static void bench_base64(size_t size, int iterations) {
+    uint32_t failures = 0;
+    uint32_t rng = 0x9E3779B9;
+
+    size_t max_len = 200;
+    uint8_t* data = (uint8_t*)malloc(max_len);
+    char* text = (char*)malloc((max_len + 2) / 3 * 4);
+
+    for (size_t len = 0; len <= max_len; ++len) {
+        for (size_t i = 0; i < len; ++i) {
+            data[i] = (uint8_t)xorshift32(&rng);
+        }
+
+        size_t text_len = base64_encode(data, len, text);
+
+        base64_check(text, text_len, len, data, len, &failures);
+        base64_check(text, text_len, len + 64, data, len, &failures);
+        if (len > 0) {
+            base64_check(text, text_len, len - 1, NULL, 0, &failures);
+        }
+
+        // Lengths that aren't whole quanta.
+        for (size_t cut = 1; cut <= 3 && cut <= text_len; ++cut) {
+            base64_check(text, text_len - cut, len + 64, NULL, 0, &failures);
+        }
+
+        if (len % 16 == 0 || len % 24 == 23) {
+            char bad[] = { '*', '-', '_', ' ', '\0', '\x80', '\xff' };
+
+            for (size_t p = 0; p < text_len; ++p) {
+                for (uint32_t b = 0; b < ARR_LEN(bad) + 1; ++b) {
+                    // Padding is only valid in the last two characters, which get their own cases below.
+                    if (b == ARR_LEN(bad) && p + 2 >= text_len) {
+                        continue;
+                    }
+
+                    char c = text[p];
+                    text[p] = b < ARR_LEN(bad) ? bad[b] : '=';
+                    base64_check(text, text_len, len + 64, NULL, 0, &failures);
+                    text[p] = c;
+                }
+            }
+        }
+    }
+
+    struct { char* text; int len; } padding[] = {
+        { "AA==", 1 }, { "AAA=", 2 }, { "AAAAAA==", 4 },
+        { "====", -1 }, { "A===", -1 }, { "AA=A", -1 }, { "=AAA", -1 }, { "AA==AAAA", -1 }, { "AAAA====", -1 },
+    };
+
+    uint8_t zeros[4] = {};
+    for (uint32_t i = 0; i < ARR_LEN(padding); ++i) {
+        bool valid = padding[i].len >= 0;
+        base64_check(padding[i].text, strlen(padding[i].text), 64, valid ? zeros : NULL, valid ? padding[i].len : 0, &failures);
+    }
+
+    free(text);
+    free(data);
+
+    printf("base64 checks: %u failures\n", failures);
+    assert(failures == 0);
+
+    data = (uint8_t*)malloc(size);
+    text = (char*)malloc((size + 2) / 3 * 4);
+    uint8_t* out = (uint8_t*)malloc(size);
+
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (uint8_t)xorshift32(&rng);
+    }
+    size_t text_len = base64_encode(data, size, text);
+
+    for (int scalar = 0; scalar < 2; ++scalar) {
+        float start = engine_time();
+
+        bool ok = true;
+        for (int i = 0; i < iterations; ++i) {
+            ok &= scalar ? base64_decode_scalar(text, text_len, out, size, NULL) : base64_decode(text, text_len, out, size, NULL);
+        }
+
+        float total = engine_time() - start;
+
+        if (!ok || memcmp(out, data, size) != 0) {
+            fprintf(stderr, "base64: %s decoder failed the timed run\n", scalar ? "scalar" : "vector");
+            exit(1);
+        }
+
+        printf("%s: %.2f ms per %.1f MB | %.0f MB/s\n", scalar ? "scalar" : "vector", total * 1000.0f / (float)iterations,
+               (double)size / (1 << 20), (double)size * iterations / (1 << 20) / total);
+    }
+
+    free(out);
+    free(text);
+    free(data);
+}
+
+// A scene manifest as one top-level array of node records, about 250 bytes each.
+static char* generate_json(uint32_t record_count, size_t* o_len) {
+    size_t cap = (size_t)record_count * 320 + 16;
+    char* str = (char*)malloc(cap);
+    size_t len = 0;
+
+    str[len++] = '[';
+
+    for (uint32_t i = 0; i < record_count; ++i) {
+        len += snprintf(str + len, cap - len,
+            "%s{\"name\":\"node_%u\",\"mesh\":%u,\"translation\":[%.3f,%.3f,%.3f],\"rotation\":[0,0,0.7071068,0.7071068],"
+            "\"scale\":[1,1,1],\"children\":[%u,%u],\"extras\":{\"tag\":\"layer\\t%u\",\"visible\":%s,\"lod\":null}}",
+            i ? ",\n" : "", i, i % 997, (double)i * 0.25, -(double)i * 1e-3, 12.5, i * 2 + 1, i * 2 + 2, i % 7, i % 3 ? "true" : "false");
+    }
+
+    str[len++] = ']';
+    str[len] = '\0';
+
+    *o_len = len;
+    return str;
+}
+
+// The file at path, or a generated manifest of record_count records without one.
+static char* load_bench_json(char* path, uint32_t record_count, size_t* o_len) {
+    if (path) {
+        return load_file(path, o_len);
+    }
+    return generate_json(record_count, o_len);
+}
+
+static bool json_equal(Json* a, Json* b) {
+    if (a->type != b->type || a->len != b->len) {
+        return false;
+    }
+
+    switch (a->type) {
+        case JSON_NUMBER:
+            return a->number == b->number && a->integer == b->integer;
+        case JSON_STRING:
+            return memcmp(a->string, b->string, a->len) == 0;
+        case JSON_BOOLEAN:
+            return a->boolean == b->boolean;
+        case JSON_ARRAY:
+            for (uint32_t i = 0; i < a->len; ++i) {
+                if (!json_equal(a->arr + i, b->arr + i)) {
+                    return false;
+                }
+            }
+            return true;
+        case JSON_OBJECT:
+            for (uint32_t i = 0; i < a->len; ++i) {
+                if (a->obj[i].hash != b->obj[i].hash || strcmp(a->obj[i].name, b->obj[i].name) != 0 || !json_equal(&a->obj[i].value, &b->obj[i].value)) {
+                    return false;
+                }
+            }
+            return true;
+    }
+
+    return true;
+}
+
+struct JsonAllocCount {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// What json_parse allocated for the children of j: one block per array or pair span, name, string and key index.
+// Index sizes aren't visible outside json.cpp, so only their count is included.
+static void count_json_allocs(Json* j, JsonAllocCount* c) {
+    switch (j->type) {
+        case JSON_STRING:
+            c->count++;
+            c->bytes += j->len + 1;
+            break;
+        case JSON_ARRAY:
+            if (j->len) {
+                c->count++;
+                c->bytes += j->len * sizeof(Json);
+            }
+            for (uint32_t i = 0; i < j->len; ++i) {
+                count_json_allocs(j->arr + i, c);
+            }
+            break;
+        case JSON_OBJECT:
+            if (j->len) {
+                c->count++;
+                c->bytes += j->len * sizeof(JsonPair);
+            }
+            if (j->obj_index) {
+                c->count++;
+            }
+            for (uint32_t i = 0; i < j->len; ++i) {
+                c->count++;
+                c->bytes += strlen(j->obj[i].name) + 1;
+                count_json_allocs(&j->obj[i].value, c);
+            }
+            break;
+    }
+}
+
+enum JsonAllocMode {
+    JSON_ALLOC_MALLOC,
+    JSON_ALLOC_ARENA,
+    JSON_ALLOC_IN_SITU,
+};
+
+// Parses and frees the same document with per-node allocation (json_parse), into one arena (json_doc_parse),
+// and into one arena with strings left in the source, timing the parse and the teardown separately.
+static void bench_json_arena(char* path, int iterations) {
+    size_t len;
+    char* str = load_bench_json(path, 250000, &len);
+    char* copy = (char*)malloc(len + 1);
+
+    char* names[] = { "malloc", "arena", "in situ" };
+
+    printf("%s: %.1f MB\n", path ? path : "generated", (double)len / (1 << 20));
+
+    for (int mode = JSON_ALLOC_MALLOC; mode <= JSON_ALLOC_IN_SITU; ++mode) {
+        float parse_time = 0.0f;
+        float free_time = 0.0f;
+
+        for (int i = 0; i < iterations; ++i) {
+            // In-situ parsing writes terminators into the source, so it gets a fresh copy each time.
+            char* source = str;
+            if (mode == JSON_ALLOC_IN_SITU) {
+                memcpy(copy, str, len + 1);
+                source = copy;
+            }
+
+            float start = engine_time();
+
+            Json* tree = NULL;
+            JsonDoc* doc = NULL;
+            if (mode == JSON_ALLOC_MALLOC) {
+                tree = json_parse(source);
+            }
+            else {
+                doc = json_doc_parse(source, mode == JSON_ALLOC_IN_SITU ? JSON_PARSE_IN_SITU | JSON_PARSE_BORROW_SOURCE : 0);
+            }
+
+            float parsed = engine_time();
+
+            if (i == iterations - 1) {
+                if (tree) {
+                    JsonAllocCount count = { 1, sizeof(Json) };
+                    count_json_allocs(tree, &count);
+                    printf("%-7s | %llu allocations, %.1f MB", names[mode], (unsigned long long)count.count, (double)count.bytes / (1 << 20));
+                }
+                else {
+                    ArenaStats stats;
+                    arena_stats(&doc->arena, &stats);
+                    printf("%-7s | %d blocks, %.1f of %.1f MB used", names[mode], stats.block_count, (double)stats.used / (1 << 20), (double)stats.reserved / (1 << 20));
+                }
+            }
+
+            float start_free = engine_time();
+
+            if (tree) {
+                json_free(tree);
+            }
+            else {
+                json_doc_free(doc);
+            }
+
+            parse_time += parsed - start;
+            free_time += engine_time() - start_free;
+        }
+
+        printf(" | parse %8.2f ms (%7.1f MB/s) | free %7.2f ms\n", parse_time * 1000.0f / (float)iterations,
+               (double)len * iterations / (1 << 20) / parse_time, free_time * 1000.0f / (float)iterations);
+    }
+
+    free(copy);
+    free(str);
+}
+
+// Best-of-iterations parse throughput for each file, or the generated manifest when none are given.
+// Teardown isn't timed, so the tree and arena parses compare the single lexing pass they share.
+static void bench_json_parse(char** paths, int path_count, int iterations) {
+    for (int f = 0; f < (path_count ? path_count : 1); ++f) {
+        char* path = path_count ? paths[f] : NULL;
+
+        size_t len;
+        char* str = load_bench_json(path, 250000, &len);
+
+        float best_tree = 1e30f;
+        float best_doc = 1e30f;
+
+        for (int i = 0; i < iterations; ++i) {
+            float start = engine_time();
+            Json* tree = json_parse(str);
+            float time = engine_time() - start;
+            json_free(tree);
+
+            if (time < best_tree) {
+                best_tree = time;
+            }
+
+            start = engine_time();
+            JsonDoc* doc = json_doc_parse(str, 0);
+            time = engine_time() - start;
+            json_doc_free(doc);
+
+            if (time < best_doc) {
+                best_doc = time;
+            }
+        }
+
+        double mb = (double)len / (1 << 20);
+        printf("%-32s %9.3f MB | json_parse %8.3f ms %7.1f MB/s | json_doc_parse %8.3f ms %7.1f MB/s\n", path ? path : "generated",
+               mb, best_tree * 1000.0f, mb / best_tree, best_doc * 1000.0f, mb / best_doc);
+
+        free(str);
+    }
+}
+
+struct JsonShape {
+    uint64_t containers;
+    uint64_t keys;
+    uint64_t values;
+    double number_sum;
+};
+
+static void json_shape(Json* j, JsonShape* shape) {
+    switch (j->type) {
+        case JSON_ARRAY:
+            shape->containers++;
+            for (uint32_t i = 0; i < j->len; ++i) {
+                json_shape(j->arr + i, shape);
+            }
+            break;
+        case JSON_OBJECT:
+            shape->containers++;
+            shape->keys += j->len;
+            for (uint32_t i = 0; i < j->len; ++i) {
+                json_shape(&j->obj[i].value, shape);
+            }
+            break;
+        case JSON_NUMBER:
+            shape->number_sum += j->number;
+            shape->values++;
+            break;
+        default:
+            shape->values++;
+            break;
+    }
+}
+
+// Memory needed to walk a document through the pull reader fed in chunk_size pieces, as a loader would while
+// reading the file, against holding the source and a tree. Both walks must see the same containers, keys and values.
+static void bench_json_stream(char* path, size_t chunk_size) {
+    assert(chunk_size > 0);
+
+    size_t len;
+    char* str = load_bench_json(path, 250000, &len);
+
+    float start = engine_time();
+
+    JsonShape streamed = {};
+    JsonReader* r = json_reader_create();
+    size_t fed = 0;
+
+    for (;;) {
+        JsonEvent e = json_reader_next(r);
+
+        if (e.type == JSON_EVENT_NEED_MORE) {
+            size_t n = len - fed < chunk_size ? len - fed : chunk_size;
+            json_reader_feed(r, str + fed, n);
+            fed += n;
+
+            if (fed == len) {
+                json_reader_finish(r);
+            }
+            continue;
+        }
+
+        if (e.type == JSON_EVENT_END || e.type == JSON_EVENT_ERROR) {
+            if (e.type == JSON_EVENT_ERROR) {
+                fprintf(stderr, "reader: bad json\n");
+                exit(1);
+            }
+            break;
+        }
+
+        switch (e.type) {
+            case JSON_EVENT_BEGIN_OBJECT:
+            case JSON_EVENT_BEGIN_ARRAY:
+                streamed.containers++;
+                break;
+            case JSON_EVENT_KEY:
+                streamed.keys++;
+                break;
+            case JSON_EVENT_VALUE:
+                json_shape(&e.value, &streamed);
+                break;
+        }
+    }
+
+    float stream_time = engine_time() - start;
+    size_t reader_memory = json_reader_memory(r);
+    json_reader_free(r);
+
+    start = engine_time();
+    Json* tree = json_parse(str);
+    float tree_time = engine_time() - start;
+
+    JsonShape parsed = {};
+    json_shape(tree, &parsed);
+
+    JsonAllocCount tree_allocs = { 1, sizeof(Json) };
+    count_json_allocs(tree, &tree_allocs);
+    json_free(tree);
+
+    start = engine_time();
+    JsonDoc* doc = json_doc_parse(str, 0);
+    float doc_time = engine_time() - start;
+
+    ArenaStats doc_stats;
+    arena_stats(&doc->arena, &doc_stats);
+    json_doc_free(doc);
+
+    if (streamed.containers != parsed.containers || streamed.keys != parsed.keys || streamed.values != parsed.values || streamed.number_sum != parsed.number_sum) {
+        fprintf(stderr, "reader and tree disagree\n");
+        exit(1);
+    }
+
+    printf("%s: %.1f MB | %llu containers, %llu keys, %llu values\n", path ? path : "generated", (double)len / (1 << 20),
+           (unsigned long long)parsed.containers, (unsigned long long)parsed.keys, (unsigned long long)parsed.values);
+    printf("reader         | %8.2f ms | %8.1f KB: %.1f KB chunk + %.1f KB reader\n", stream_time * 1000.0f,
+           (double)(chunk_size + reader_memory) / 1024, (double)chunk_size / 1024, (double)reader_memory / 1024);
+    printf("json_parse     | %8.2f ms | %8.1f KB: %.1f KB source + %.1f KB in %llu allocations\n", tree_time * 1000.0f,
+           (double)(len + 1 + tree_allocs.bytes) / 1024, (double)(len + 1) / 1024, (double)tree_allocs.bytes / 1024, (unsigned long long)tree_allocs.count);
+    printf("json_doc_parse | %8.2f ms | %8.1f KB: %.1f KB source + %.1f KB arena\n", doc_time * 1000.0f,
+           (double)(len + 1 + doc_stats.reserved) / 1024, (double)(len + 1) / 1024, (double)doc_stats.reserved / 1024);
+
+    free(str);
+}
+
+// Parses the same document with 1 to 16 workers against a serial json_doc_parse, checking each tree matches.
+// Thread counts past the core count are still run, to show the oversubscribed cost.
+static void bench_json_parallel(char* path, int iterations) {
+    size_t len;
+    char* str = load_bench_json(path, 250000, &len);
+
+    float start = engine_time();
+    for (int i = 0; i < iterations; ++i) {
+        json_doc_free(json_doc_parse(str, 0));
+    }
+    float serial_time = (engine_time() - start) / (float)iterations;
+
+    JsonDoc* serial = json_doc_parse(str, 0);
+
+    printf("%s: %.1f MB, %d cores\n", path ? path : "generated", (double)len / (1 << 20), cpu_count());
+    printf("serial     | %8.2f ms | %7.1f MB/s\n", serial_time * 1000.0f, (double)len / (1 << 20) / serial_time);
+
+    for (int thread_count = 1; thread_count <= 16; thread_count *= 2) {
+        JobSystem* js = jobs_init(thread_count);
+
+        start = engine_time();
+        for (int i = 0; i < iterations; ++i) {
+            json_doc_free(json_doc_parse_parallel(js, str, 0));
+        }
+        float time = (engine_time() - start) / (float)iterations;
+
+        JsonDoc* doc = json_doc_parse_parallel(js, str, 0);
+        if (!json_equal(serial->root, doc->root)) {
+            fprintf(stderr, "%d threads: tree differs from the serial parse\n", thread_count);
+            exit(1);
+        }
+        json_doc_free(doc);
+
+        printf("%2d threads | %8.2f ms | %7.1f MB/s (%.2fx)\n",
+               thread_count, time * 1000.0f, (double)len / (1 << 20) / time, serial_time / time);
+
+        jobs_free(js);
+    }
+
+    json_doc_free(serial);
+    free(str);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <model.gltf|model.glb|model.mesh> [iterations] [cache_dir]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-jobs\n", argv[0]);
+        fprintf(stderr, "       %s --bench-mesh-pool [live_meshes] [frames]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-descriptors [capacity] [frames]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-buffer-heap [live_buffers] [frames]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-upload-ring [capacity_kb] [frames]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-base64 [size_mb] [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-json-arena [file.json] [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-json-parse [iterations] [file.json...]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-json-stream [file.json] [chunk_kb]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-json-parallel [file.json] [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-render <model.gltf|model.glb> [frames] [out.ppm]\n", argv[0]);
+        return 1;
+    }
+
+    platform_init();
+
+    if (strcmp(argv[1], "--bench-jobs") == 0) {
+        bench_jobs();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-mesh-pool") == 0) {
+        bench_mesh_pool(argc > 2 ? (uint32_t)atoi(argv[2]) : 50000, argc > 3 ? atoi(argv[3]) : 1000);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-descriptors") == 0) {
+        bench_descriptors(argc > 2 ? (uint32_t)atoi(argv[2]) : 1 << 16, argc > 3 ? atoi(argv[3]) : 1000);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-buffer-heap") == 0) {
+        bench_buffer_heap(argc > 2 ? (uint32_t)atoi(argv[2]) : 10000, argc > 3 ? atoi(argv[3]) : 1000);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-upload-ring") == 0) {
+        bench_upload_ring(argc > 2 ? (uint64_t)(atof(argv[2]) * 1024) : 4 << 20, argc > 3 ? atoi(argv[3]) : 10000);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-base64") == 0) {
+        bench_base64((size_t)(argc > 2 ? atoi(argv[2]) : 16) << 20, argc > 3 ? atoi(argv[3]) : 20);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-json-arena") == 0) {
+        bench_json_arena(argc > 2 ? argv[2] : NULL, argc > 3 ? atoi(argv[3]) : 5);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-json-parse") == 0) {
+        bench_json_parse(argv + 3, argc > 3 ? argc - 3 : 0, argc > 2 ? atoi(argv[2]) : 10);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-json-stream") == 0) {
+        bench_json_stream(argc > 2 ? argv[2] : NULL, (size_t)(argc > 3 ? atoi(argv[3]) : 64) << 10);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-json-parallel") == 0) {
+        bench_json_parallel(argc > 2 ? argv[2] : NULL, argc > 3 ? atoi(argv[3]) : 5);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--bench-render") == 0 && argc > 2) {
+        bench_render(argv[2], argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? argv[4] : NULL);
+        return 0;
+    }
+
+    char* path = argv[1];
+    int iterations = argc > 2 ? atoi(argv[2]) : 1;
+    char* cache_dir = argc > 3 ? argv[3] : NULL;
+
+    size_t path_len = strlen(path);
+    if (path_len > 5 && strcmp(path + path_len - 5, ".mesh") == 0) {
+        bench_mesh_blob(path, iterations);
+        return 0;
+    }
+
+    JobSystem* js = jobs_init(cpu_count());
+
+    for (int i = 0; i < iterations; ++i) {
+        MeshTotals totals = {};
+        GltfStats stats = {};
+
+        float start = engine_time();
+        if (cache_dir) {
+            load_gltf_cached(js, path, cache_dir, count_mesh, &totals, &stats);
+        }
+        else {
+            load_gltf(js, path, count_mesh, &totals, &stats);
+        }
+        float total = engine_time() - start;
+
+        if (i == 0) {
+            printf("%s: %u meshes, %llu vertices, %llu indices\n", path, totals.mesh_count, (unsigned long long)totals.vertex_count, (unsigned long long)totals.index_count);
+        }
+
+        printf("map %8.3f ms | parse %8.3f ms | resolve %8.3f ms | buffers %8.3f ms | meshes %8.3f ms | total %8.3f ms%s\n",
+               stats.map_time * 1000.0f, stats.parse_time * 1000.0f, stats.resolve_time * 1000.0f,
+               stats.buffer_wait_time * 1000.0f, stats.mesh_time * 1000.0f, total * 1000.0f,
+               stats.cache_hit ? " (cached)" : "");
+
+        if (i == 0 && !stats.cache_hit) {
+            print_opt_stats(stats.opt_before, stats.opt_after);
+        }
+
+        if (i == 0 && stats.skipped_primitives) {
+            printf("%u primitives skipped\n", stats.skipped_primitives);
+        }
+    }
+
+    jobs_free(js);
+
+    return 0;
+}
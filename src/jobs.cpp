@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "jobs.h"
+
+#define JOB_DEQUE_CAPACITY 4096
+#define JOB_SPIN_COUNT 64
+
+struct ParallelFor {
+    ParallelForProc* proc;
+    void* arg;
+    uint32_t batch_size;
+};
+
+// A plain job has proc set; a parallel_for range has range set and covers [begin, end).
+struct Job {
+    JobProc* proc;
+    void* arg;
+    ParallelFor* range;
+    uint32_t begin;
+    uint32_t end;
+    JobCounter* counter;
+};
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, other workers steal from the top.
+// top and bottom sit on separate cache lines since thieves hammer one and the owner the other.
+struct JobDeque {
+    volatile uint32_t top;
+    char pad_top[60];
+    volatile uint32_t bottom;
+    char pad_bottom[60];
+    Job jobs[JOB_DEQUE_CAPACITY];
+};
+
+struct JobWorker {
+    JobDeque deque;
+    JobSystem* js;
+    Thread* thread;
+    uint32_t rng;
+};
+
+struct JobSystem {
+    JobWorker* workers;
+    int worker_count;
+    Semaphore* wake;
+    volatile uint32_t sleeping;
+    volatile uint32_t quit;
+};
+
+static thread_local JobWorker* current_worker;
+
+static bool deque_push(JobDeque* d, Job* job) {
+    uint32_t b = d->bottom;
+    uint32_t t = atomic_load32(&d->top);
+
+    if (b - t >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+
+    d->jobs[b % JOB_DEQUE_CAPACITY] = *job;
+    atomic_store32(&d->bottom, b + 1);
+
+    return true;
+}
+
+static bool deque_pop(JobDeque* d, Job* o_job) {
+    uint32_t b = d->bottom - 1;
+    atomic_store32(&d->bottom, b);
+    atomic_fence();
+    uint32_t t = atomic_load32(&d->top);
+
+    if ((int32_t)(b - t) < 0) {
+        atomic_store32(&d->bottom, t);
+        return false;
+    }
+
+    *o_job = d->jobs[b % JOB_DEQUE_CAPACITY];
+
+    if (b != t) {
+        return true;
+    }
+
+    // Last job: race thieves for it through top.
+    bool won = atomic_cas32(&d->top, t, t + 1);
+    atomic_store32(&d->bottom, t + 1);
+
+    return won;
+}
+
+static bool deque_steal(JobDeque* d, Job* o_job) {
+    uint32_t t = atomic_load32(&d->top);
+    atomic_fence();
+    uint32_t b = atomic_load32(&d->bottom);
+
+    if ((int32_t)(b - t) <= 0) {
+        return false;
+    }
+
+    *o_job = d->jobs[t % JOB_DEQUE_CAPACITY];
+
+    return atomic_cas32(&d->top, t, t + 1);
+}
+
+static bool find_job(JobWorker* w, Job* o_job) {
+    if (deque_pop(&w->deque, o_job)) {
+        return true;
+    }
+
+    JobSystem* js = w->js;
+
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 17;
+    w->rng ^= w->rng << 5;
+
+    uint32_t count = (uint32_t)js->worker_count;
+    uint32_t start = w->rng % count;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        JobWorker* victim = js->workers + (start + i) % count;
+        if (victim != w && deque_steal(&victim->deque, o_job)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void run_job(JobWorker* w, Job* job);
+
+static void push_job(JobWorker* w, Job* job) {
+    if (!deque_push(&w->deque, job)) {
+        run_job(w, job);
+        return;
+    }
+
+    JobSystem* js = w->js;
+
+    atomic_fence();
+    if (atomic_load32(&js->sleeping)) {
+        semaphore_signal(js->wake, 1);
+    }
+}
+
+static void run_job(JobWorker* w, Job* job) {
+    if (job->range) {
+        ParallelFor* pf = job->range;
+
+        uint32_t begin = job->begin;
+        uint32_t end = job->end;
+
+        while (end - begin > pf->batch_size) {
+            uint32_t mid = begin + (end - begin) / 2;
+
+            Job half = *job;
+            half.begin = mid;
+            half.end = end;
+
+            atomic_fetch_add32(&job->counter->pending, 1);
+            push_job(w, &half);
+
+            end = mid;
+        }
+
+        pf->proc(pf->arg, begin, end);
+    }
+    else {
+        job->proc(job->arg);
+    }
+
+    atomic_fetch_add32(&job->counter->pending, (uint32_t)-1);
+}
+
+static void worker_main(void* arg) {
+    JobWorker* w = (JobWorker*)arg;
+    JobSystem* js = w->js;
+
+    current_worker = w;
+
+    int idle = 0;
+
+    while (!atomic_load32(&js->quit)) {
+        Job job;
+
+        if (find_job(w, &job)) {
+            run_job(w, &job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < JOB_SPIN_COUNT) {
+            thread_yield();
+            continue;
+        }
+
+        // Announce the sleep before the last look, so a push either sees the sleeper or gets found here.
+        atomic_fetch_add32(&js->sleeping, 1);
+        atomic_fence();
+
+        if (find_job(w, &job)) {
+            atomic_fetch_add32(&js->sleeping, (uint32_t)-1);
+            run_job(w, &job);
+            idle = 0;
+            continue;
+        }
+
+        if (!atomic_load32(&js->quit)) {
+            semaphore_wait(js->wake);
+        }
+
+        atomic_fetch_add32(&js->sleeping, (uint32_t)-1);
+        idle = 0;
+    }
+
+    current_worker = NULL;
+}
+
+JobSystem* jobs_init(int thread_count) {
+    assert(!current_worker && "Thread already belongs to a job system");
+
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    JobSystem* js = (JobSystem*)calloc(1, sizeof(JobSystem));
+    js->worker_count = thread_count;
+    js->workers = (JobWorker*)calloc(thread_count, sizeof(JobWorker));
+    js->wake = semaphore_create(0);
+
+    for (int i = 0; i < thread_count; ++i) {
+        JobWorker* w = js->workers + i;
+        w->js = js;
+        w->rng = 0x9E3779B9u * (uint32_t)(i + 1);
+    }
+
+    current_worker = js->workers;
+
+    for (int i = 1; i < thread_count; ++i) {
+        js->workers[i].thread = thread_start(worker_main, js->workers + i);
+    }
+
+    return js;
+}
+
+void jobs_free(JobSystem* js) {
+    assert(current_worker == js->workers && "Job system must be freed by the thread that created it");
+
+    atomic_store32(&js->quit, 1);
+    semaphore_signal(js->wake, js->worker_count);
+
+    for (int i = 1; i < js->worker_count; ++i) {
+        thread_join(js->workers[i].thread);
+    }
+
+    current_worker = NULL;
+
+    semaphore_free(js->wake);
+    free(js->workers);
+    free(js);
+}
+
+int jobs_thread_count(JobSystem* js) {
+    return js->worker_count;
+}
+
+void jobs_run(JobSystem* js, JobProc* proc, void* arg, JobCounter* counter) {
+    JobWorker* w = current_worker;
+    assert(w && w->js == js && "Jobs can only be queued from worker threads");
+    UNUSED(js);
+
+    Job job = {};
+    job.proc = proc;
+    job.arg = arg;
+    job.counter = counter;
+
+    atomic_fetch_add32(&counter->pending, 1);
+    push_job(w, &job);
+}
+
+void jobs_wait(JobSystem* js, JobCounter* counter) {
+    JobWorker* w = current_worker;
+    assert(w && w->js == js && "Only worker threads can wait on jobs");
+    UNUSED(js);
+
+    while (atomic_load32(&counter->pending) != 0) {
+        Job job;
+
+        if (find_job(w, &job)) {
+            run_job(w, &job);
+        }
+        else {
+            thread_yield();
+        }
+    }
+}
+
+void parallel_for(JobSystem* js, uint32_t count, uint32_t batch_size, ParallelForProc* proc, void* arg) {
+    JobWorker* w = current_worker;
+    assert(w && w->js == js && "parallel_for can only be called from worker threads");
+
+    if (count == 0) {
+        return;
+    }
+
+    ParallelFor pf;
+    pf.proc = proc;
+    pf.arg = arg;
+    pf.batch_size = batch_size ? batch_size : 1;
+
+    JobCounter counter = {};
+
+    Job job = {};
+    job.range = &pf;
+    job.begin = 0;
+    job.end = count;
+    job.counter = &counter;
+
+    atomic_fetch_add32(&counter.pending, 1);
+    run_job(w, &job);
+
+    jobs_wait(js, &counter);
+}
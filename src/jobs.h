@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common.h"
+
+struct JobSystem;
+
+// Tracks outstanding jobs. Zero it, pass it to jobs_run, then jobs_wait on it.
+struct JobCounter {
+    volatile uint32_t pending;
+};
+
+typedef void JobProc(void* arg);
+typedef void ParallelForProc(void* arg, uint32_t begin, uint32_t end);
+
+// The calling thread becomes the first worker and runs jobs whenever it waits. thread_count - 1 more threads are started.
+JobSystem* jobs_init(int thread_count);
+void jobs_free(JobSystem* js);
+int jobs_thread_count(JobSystem* js);
+
+// May be called from any worker thread, including from inside a running job.
+void jobs_run(JobSystem* js, JobProc* proc, void* arg, JobCounter* counter);
+
+// Runs queued jobs until the counter reaches zero. A job that waits on the jobs it spawned expresses a dependency.
+void jobs_wait(JobSystem* js, JobCounter* counter);
+
+// Calls proc on ranges of at most batch_size items covering [0, count), and returns once all of them have run.
+// Ranges are split in half on demand, so idle workers steal large chunks first.
+void parallel_for(JobSystem* js, uint32_t count, uint32_t batch_size, ParallelForProc* proc, void* arg);
@@ -1,10 +1,27 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_SIMD_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define JSON_SIMD_WIDTH 16
+#endif
 
 #include "json.h"
 
+#define JSON_DOC_BLOCK_SIZE (64 * 1024)
+#define JSON_INDEX_THRESHOLD 8
+#define JSON_PARALLEL_MIN_BYTES (256 * 1024)
+
+// Open-addressed table of an object's pairs, built at parse time for objects with at least JSON_INDEX_THRESHOLD members.
+struct JsonIndex {
+    uint32_t mask;
+    JsonPair* slots[1];
+};
+
 struct Scanner {
     char* ptr;
     int line;
@@ -33,6 +50,23 @@ struct Token {
     int line;
 };
 
+// Children are parsed onto these scratch stacks, then copied into one contiguous span when their container closes.
+struct ParserStack {
+    void* data;
+    uint32_t count;
+    uint32_t cap;
+};
+
+struct Parser {
+    Scanner s;
+    Token lookahead;
+    Arena* arena;
+    bool in_situ;
+
+    ParserStack elements;
+    ParserStack pairs;
+};
+
 static char scanner_advance(Scanner* s) {
     char c = *s->ptr;
 
@@ -47,10 +81,182 @@ static char scanner_advance(Scanner* s) {
     return c;
 }
 
-static Token scan(Scanner* s) {
-    while (isspace(*s->ptr)) {
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static void skip_digits(Scanner* s) {
+    while (is_digit(*s->ptr)) {
+        ++s->ptr;
+    }
+}
+
+static bool is_json_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#if JSON_SIMD_WIDTH
+
+// Block scanning only ever loads aligned blocks, and stops at the block holding the terminator,
+// so it never touches a page the string doesn't. It can still read bytes outside the allocation
+// on either side, so the scanners are exempt from AddressSanitizer.
+
+#if defined(_MSC_VER)
+#define SIMD_NO_SANITIZE __declspec(no_sanitize_address)
+#else
+#define SIMD_NO_SANITIZE __attribute__((no_sanitize_address))
+#endif
+
+#if JSON_SIMD_WIDTH == 32
+typedef __m256i SimdBlock;
+#define SIMD_FULL_MASK 0xFFFFFFFFu
+#define simd_load(p) _mm256_load_si256((const __m256i*)(p))
+#define simd_splat(c) _mm256_set1_epi8(c)
+#define simd_eq(a, b) _mm256_cmpeq_epi8(a, b)
+#define simd_or(a, b) _mm256_or_si256(a, b)
+#define simd_mask(a) ((uint32_t)_mm256_movemask_epi8(a))
+#else
+typedef __m128i SimdBlock;
+#define SIMD_FULL_MASK 0xFFFFu
+#define simd_load(p) _mm_load_si128((const __m128i*)(p))
+#define simd_splat(c) _mm_set1_epi8(c)
+#define simd_eq(a, b) _mm_cmpeq_epi8(a, b)
+#define simd_or(a, b) _mm_or_si128(a, b)
+#define simd_mask(a) ((uint32_t)_mm_movemask_epi8(a))
+#endif
+
+static char* block_start(char* p, uint32_t* o_skip_mask) {
+    uint32_t misalign = (uint32_t)((uintptr_t)p & (JSON_SIMD_WIDTH - 1));
+    *o_skip_mask = (1u << misalign) - 1;
+    return p - misalign;
+}
+
+static uint32_t bits_below(uint32_t idx) {
+    return (1u << idx) - 1;
+}
+
+SIMD_NO_SANITIZE static void skip_whitespace(Scanner* s) {
+    if (!is_json_space(*s->ptr)) {
+        return;
+    }
+
+    uint32_t skip_mask;
+    char* block = block_start(s->ptr, &skip_mask);
+
+    for (;;) {
+        SimdBlock b = simd_load(block);
+        SimdBlock nl = simd_eq(b, simd_splat('\n'));
+        SimdBlock ws = simd_or(simd_or(simd_eq(b, simd_splat(' ')), nl), simd_or(simd_eq(b, simd_splat('\r')), simd_eq(b, simd_splat('\t'))));
+
+        uint32_t nl_mask = simd_mask(nl) & ~skip_mask;
+        uint32_t other_mask = ~(simd_mask(ws) | skip_mask) & SIMD_FULL_MASK;
+
+        if (other_mask) {
+            uint32_t idx = ctz32(other_mask);
+            s->line += popcount32(nl_mask & bits_below(idx));
+            s->ptr = block + idx;
+            return;
+        }
+
+        s->line += popcount32(nl_mask);
+        block += JSON_SIMD_WIDTH;
+        skip_mask = 0;
+    }
+}
+
+// Leaves the scanner on the closing quote, or on the terminator if the string is unterminated.
+SIMD_NO_SANITIZE static void skip_string_body(Scanner* s) {
+    uint32_t skip_mask;
+    char* block = block_start(s->ptr, &skip_mask);
+
+    for (;;) {
+        SimdBlock b = simd_load(block);
+        SimdBlock special = simd_or(simd_or(simd_eq(b, simd_splat('"')), simd_eq(b, simd_splat('\\'))), simd_eq(b, simd_splat('\0')));
+
+        uint32_t nl_mask = simd_mask(simd_eq(b, simd_splat('\n'))) & ~skip_mask;
+        uint32_t special_mask = simd_mask(special) & ~skip_mask;
+
+        if (special_mask) {
+            uint32_t idx = ctz32(special_mask);
+            s->line += popcount32(nl_mask & bits_below(idx));
+            char* p = block + idx;
+
+            if (*p != '\\') {
+                s->ptr = p;
+                return;
+            }
+
+            s->ptr = p + 1;
+            if (*s->ptr == '\0') {
+                return;
+            }
+
+            scanner_advance(s);
+            block = block_start(s->ptr, &skip_mask);
+            continue;
+        }
+
+        s->line += popcount32(nl_mask);
+        block += JSON_SIMD_WIDTH;
+        skip_mask = 0;
+    }
+}
+
+SIMD_NO_SANITIZE static char* find_structural(char* p) {
+    uint32_t skip_mask;
+    char* block = block_start(p, &skip_mask);
+
+    for (;;) {
+        SimdBlock b = simd_load(block);
+        SimdBlock brackets = simd_or(simd_or(simd_eq(b, simd_splat('[')), simd_eq(b, simd_splat(']'))), simd_or(simd_eq(b, simd_splat('{')), simd_eq(b, simd_splat('}'))));
+        SimdBlock other = simd_or(simd_or(simd_eq(b, simd_splat('"')), simd_eq(b, simd_splat(','))), simd_eq(b, simd_splat('\0')));
+
+        uint32_t mask = simd_mask(simd_or(brackets, other)) & ~skip_mask;
+
+        if (mask) {
+            return block + ctz32(mask);
+        }
+
+        block += JSON_SIMD_WIDTH;
+        skip_mask = 0;
+    }
+}
+
+#else
+
+static char* find_structural(char* p) {
+    while (*p != '"' && *p != ',' && *p != '[' && *p != ']' && *p != '{' && *p != '}' && *p != '\0') {
+        ++p;
+    }
+    return p;
+}
+
+static void skip_whitespace(Scanner* s) {
+    while (is_json_space(*s->ptr)) {
         scanner_advance(s);
     }
+}
+
+static void skip_string_body(Scanner* s) {
+    for (;;) {
+        char c = *s->ptr;
+
+        if (c == '"' || c == '\0') {
+            return;
+        }
+
+        scanner_advance(s);
+
+        if (c == '\\' && *s->ptr != '\0') {
+            scanner_advance(s);
+        }
+    }
+}
+
+#endif
+
+static Token scan(Scanner* s) {
+    skip_whitespace(s);
 
     char* start = s->ptr;
     int line = s->line;
@@ -64,11 +270,9 @@ static Token scan(Scanner* s) {
             break;
 
         case '"': {
-            do {
-                c = scanner_advance(s);
-            } while (c != '"' && c != '\0');
+            skip_string_body(s);
 
-            if (c != '\0') {
+            if (scanner_advance(s) == '"') {
                 type = TOKEN_STRING;
             }
         } break;
@@ -117,8 +321,26 @@ static Token scan(Scanner* s) {
             break;
 
         default: {
-            if (isdigit(c) || c == '-') {
-                (void)strtof(start, &s->ptr);
+            if (c == '-' && is_digit(*s->ptr)) {
+                c = scanner_advance(s);
+            }
+
+            if (is_digit(c)) {
+                skip_digits(s);
+
+                if (*s->ptr == '.') {
+                    ++s->ptr;
+                    skip_digits(s);
+                }
+
+                if (*s->ptr == 'e' || *s->ptr == 'E') {
+                    ++s->ptr;
+                    if (*s->ptr == '+' || *s->ptr == '-') {
+                        ++s->ptr;
+                    }
+                    skip_digits(s);
+                }
+
                 type = TOKEN_NUMBER;
             };
         } break;
@@ -133,183 +355,981 @@ static Token scan(Scanner* s) {
     return tok;
 };
 
-static Token scan_peek(Scanner* s) {
-    Scanner temp = *s;
-    return scan(&temp);
+// The parser keeps exactly one token of lookahead, so every byte of the input is lexed once.
+static Token parser_next(Parser* p) {
+    Token tok = p->lookahead;
+    p->lookahead = scan(&p->s);
+    return tok;
+}
+
+static TokenType parser_peek(Parser* p) {
+    return p->lookahead.type;
 }
 
-static Token match_token(Scanner* s, TokenType type) {
+static Token parser_match(Parser* p, TokenType type) {
     UNUSED(type);
-    Token tok = scan(s);
+    Token tok = parser_next(p);
     assert(tok.type == type && "bad json");
     return tok;
 }
 
-static Json* make_json(JsonType type) {
-    Json* j = (Json*)calloc(1, sizeof(Json));
-    j->type = type;
-    return j;
+static void* parser_alloc(Parser* p, size_t size) {
+    if (p->arena) {
+        return arena_push(p->arena, size);
+    }
+    return calloc(1, size);
 }
 
-static char* extract_string(Token tok) {
+static char* extract_string(Parser* p, Token tok) {
     assert(tok.type == TOKEN_STRING);
+
+    if (p->in_situ) {
+        tok.ptr[tok.len - 1] = '\0';
+        return tok.ptr + 1;
+    }
+
+    if (p->arena) {
+        return arena_push_string(p->arena, tok.ptr + 1, tok.len - 2);
+    }
+
     char* str = (char*)malloc(tok.len - 1);
     memcpy(str, tok.ptr + 1, tok.len - 2);
     str[tok.len - 2] = '\0';
     return str;
 }
 
-static Json* parse_unknown(Scanner* s) {
-    Token tok = scan(s);
+static uint32_t hash_string(char* str, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool pair_matches(JsonPair* pair, JsonKey key) {
+    return pair->hash == key.hash && strcmp(pair->name, key.name) == 0;
+}
+
+static JsonIndex* build_index(Parser* p, JsonPair* pairs, uint32_t count) {
+    uint32_t cap = 1;
+    while (cap < count * 2) {
+        cap *= 2;
+    }
+
+    JsonIndex* index = (JsonIndex*)parser_alloc(p, sizeof(JsonIndex) + (cap - 1) * sizeof(JsonPair*));
+    index->mask = cap - 1;
+
+    for (uint32_t n = 0; n < count; ++n) {
+        JsonPair* pair = pairs + n;
+        JsonKey key = { pair->name, pair->hash };
+
+        uint32_t i = pair->hash & index->mask;
+        while (index->slots[i] && !pair_matches(index->slots[i], key)) {
+            i = (i + 1) & index->mask;
+        }
+
+        // Keep the first of any duplicate keys, matching the linear search.
+        if (!index->slots[i]) {
+            index->slots[i] = pair;
+        }
+    }
+
+    return index;
+}
+
+static void* stack_push(ParserStack* stack, size_t elem_size) {
+    if (stack->count == stack->cap) {
+        stack->cap = stack->cap ? stack->cap * 2 : 64;
+        stack->data = realloc(stack->data, stack->cap * elem_size);
+        assert(stack->data && "out of memory");
+    }
+
+    return (char*)stack->data + elem_size * stack->count++;
+}
+
+static void* stack_pop_span(Parser* p, ParserStack* stack, size_t elem_size, uint32_t base) {
+    uint32_t count = stack->count - base;
+    if (count == 0) {
+        return NULL;
+    }
+
+    void* span = parser_alloc(p, count * elem_size);
+    memcpy(span, (char*)stack->data + base * elem_size, count * elem_size);
+    stack->count = base;
+
+    return span;
+}
+
+static const double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Locale-independent. Mantissas of up to 2^53 with a decimal exponent within +-22 take Clinger's fast path,
+// where one correctly rounded multiply or divide gives the exact result; anything else falls back to
+// strtod in the "C" locale.
+static void parse_number(Token tok, Json* j) {
+    char* p = tok.ptr;
+    char* end = tok.ptr + tok.len;
+
+    bool negative = *p == '-';
+    if (negative) {
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool integral = true;
+    bool truncated = false;
+
+    for (; p < end && is_digit(*p); ++p) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else {
+            ++exp10;
+            truncated = true;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        integral = false;
+        for (++p; p < end && is_digit(*p); ++p) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exp10;
+            }
+            else {
+                truncated = true;
+            }
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        ++p;
+
+        bool exp_negative = *p == '-';
+        if (*p == '+' || *p == '-') {
+            ++p;
+        }
+
+        int e = 0;
+        for (; p < end && is_digit(*p); ++p) {
+            if (e < 100000) {
+                e = e * 10 + (*p - '0');
+            }
+        }
+
+        exp10 += exp_negative ? -e : e;
+    }
+
+    j->integer = 0;
+
+    if (integral && !truncated) {
+        if (negative && mantissa <= (uint64_t)INT64_MAX + 1) {
+            j->integer = (int64_t)(~mantissa + 1);
+        }
+        else if (!negative && mantissa <= (uint64_t)INT64_MAX) {
+            j->integer = (int64_t)mantissa;
+        }
+    }
+
+    double d;
+
+    if (mantissa == 0 && !truncated) {
+        d = 0.0;
+    }
+    else if (!truncated && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        d = (double)mantissa;
+        d = exp10 < 0 ? d / exact_powers_of_ten[-exp10] : d * exact_powers_of_ten[exp10];
+    }
+    else {
+        d = parse_double(negative ? tok.ptr + 1 : tok.ptr, NULL);
+    }
+
+    j->number = negative ? -d : d;
+
+    if (!integral && j->number >= -9.2e18 && j->number <= 9.2e18 && (double)(int64_t)j->number == j->number) {
+        j->integer = (int64_t)j->number;
+    }
+}
+
+static void parse_unknown(Parser* p, Json* j) {
+    Token tok = parser_next(p);
     switch (tok.type) {
-        case TOKEN_NULL: return make_json(JSON_NULL);
-        case TOKEN_NUMBER: {
-            Json* j = make_json(JSON_NUMBER);
-            j->number = strtof(tok.ptr, NULL);
-            return j;
-        };
-        case TOKEN_STRING: {
-            Json* j = make_json(JSON_STRING);
-            j->string = extract_string(tok);
-            return j;
-        };
-        case TOKEN_TRUE: {
+        case TOKEN_NULL:
+            j->type = JSON_NULL;
+            return;
+        case TOKEN_NUMBER:
+            j->type = JSON_NUMBER;
+            parse_number(tok, j);
+            return;
+        case TOKEN_STRING:
+            j->type = JSON_STRING;
+            j->string = extract_string(p, tok);
+            j->len = tok.len - 2;
+            return;
+        case TOKEN_TRUE:
         case TOKEN_FALSE:
-            Json* j = make_json(JSON_BOOLEAN);
+            j->type = JSON_BOOLEAN;
             j->boolean = tok.type == TOKEN_TRUE;
-            return j;
-        };
+            return;
 
         case TOKEN_LSQUARE: {
-            Json head = {};
-            Json* cur = &head;
+            uint32_t base = p->elements.count;
 
-            while (scan_peek(s).type != TOKEN_RSQUARE) {
-                if (head.next) {
-                    match_token(s, TOKEN_COMMA);
+            while (parser_peek(p) != TOKEN_RSQUARE) {
+                if (p->elements.count != base) {
+                    parser_match(p, TOKEN_COMMA);
                 }
 
-                cur = cur->next = parse_unknown(s);
+                Json el = {};
+                parse_unknown(p, &el);
+                *(Json*)stack_push(&p->elements, sizeof(Json)) = el;
             }
 
-            match_token(s, TOKEN_RSQUARE);
+            parser_match(p, TOKEN_RSQUARE);
+
+            j->type = JSON_ARRAY;
+            j->len = p->elements.count - base;
+            j->arr = (Json*)stack_pop_span(p, &p->elements, sizeof(Json), base);
 
-            Json* arr = make_json(JSON_ARRAY);
-            arr->arr_first = head.next;
-            
-            return arr;
+            return;
         };
 
         case TOKEN_LBRACE: {
-            JsonPair head = {};
-            JsonPair* cur = &head;
+            uint32_t base = p->pairs.count;
 
-            while (scan_peek(s).type != TOKEN_RBRACE) {
-                if (head.next) {
-                    match_token(s, TOKEN_COMMA);
+            while (parser_peek(p) != TOKEN_RBRACE) {
+                if (p->pairs.count != base) {
+                    parser_match(p, TOKEN_COMMA);
                 }
 
-                Token name_tok = match_token(s, TOKEN_STRING);
-                match_token(s, TOKEN_COLON);
+                Token name_tok = parser_match(p, TOKEN_STRING);
+                parser_match(p, TOKEN_COLON);
 
-                JsonPair* pair = (JsonPair*)calloc(1, sizeof(JsonPair));
-                pair->name = extract_string(name_tok);
-                pair->json = parse_unknown(s);
+                JsonPair pair = {};
+                pair.name = extract_string(p, name_tok);
+                pair.hash = hash_string(name_tok.ptr + 1, name_tok.len - 2);
+                parse_unknown(p, &pair.value);
 
-                cur = cur->next = pair;
+                *(JsonPair*)stack_push(&p->pairs, sizeof(JsonPair)) = pair;
             }
 
-            match_token(s, TOKEN_RBRACE);
+            parser_match(p, TOKEN_RBRACE);
 
-            Json* obj = make_json(JSON_OBJECT);
-            obj->obj_first = head.next;
+            j->type = JSON_OBJECT;
+            j->len = p->pairs.count - base;
+            j->obj = (JsonPair*)stack_pop_span(p, &p->pairs, sizeof(JsonPair), base);
 
-            return obj;
+            if (j->len >= JSON_INDEX_THRESHOLD) {
+                j->obj_index = build_index(p, j->obj, j->len);
+            }
+
+            return;
         };
     }
     assert(false && "bad json");
-    return NULL;
+}
+
+static void parser_init(Parser* p, char* str, Arena* arena, bool in_situ) {
+    memset(p, 0, sizeof(*p));
+    p->s.ptr = str;
+    p->s.line = 1;
+    p->arena = arena;
+    p->in_situ = in_situ;
+    p->lookahead = scan(&p->s);
+}
+
+static void parser_free(Parser* p) {
+    free(p->elements.data);
+    free(p->pairs.data);
+}
+
+static Json* parse_document(char* str, Arena* arena, bool in_situ) {
+    Parser p;
+    parser_init(&p, str, arena, in_situ);
+
+    Json* j = (Json*)parser_alloc(&p, sizeof(Json));
+    parse_unknown(&p, j);
+    parser_match(&p, TOKEN_EOF);
+
+    parser_free(&p);
+
+    return j;
 }
 
 Json* json_parse(char* str) {
+    return parse_document(str, NULL, false);
+}
+
+JsonDoc* json_doc_parse(char* str, int flags) {
+    Arena arena;
+    arena_init(&arena, JSON_DOC_BLOCK_SIZE);
+
+    JsonDoc* doc = ARENA_PUSH_STRUCT(&arena, JsonDoc);
+    bool in_situ = (flags & JSON_PARSE_IN_SITU) != 0;
+
+    doc->root = parse_document(str, &arena, in_situ);
+    doc->source = in_situ && !(flags & JSON_PARSE_BORROW_SOURCE) ? str : NULL;
+    doc->arena = arena;
+
+    return doc;
+}
+
+// Records where each member of the top-level container starts, and returns its closing bracket.
+static char* split_top_level(char* open, ParserStack* starts) {
+    char* p = open + 1;
+    int depth = 0;
+
+    *(char**)stack_push(starts, sizeof(char*)) = p;
+
+    for (;;) {
+        p = find_structural(p);
+
+        switch (*p) {
+            case '"': {
+                Scanner s;
+                s.ptr = p + 1;
+                s.line = 0;
+                skip_string_body(&s);
+                assert(*s.ptr == '"' && "bad json");
+                p = s.ptr + 1;
+            } break;
+
+            case '[':
+            case '{':
+                ++depth;
+                ++p;
+                break;
+
+            case ']':
+            case '}':
+                if (depth == 0) {
+                    return p;
+                }
+                --depth;
+                ++p;
+                break;
+
+            case ',':
+                if (depth == 0) {
+                    *(char**)stack_push(starts, sizeof(char*)) = p + 1;
+                }
+                ++p;
+                break;
+
+            default:
+                assert(false && "bad json");
+                return p;
+        }
+    }
+}
+
+struct ParseJob {
+    char* start;
+    uint32_t count;
+    bool in_situ;
+    Json* elements;
+    JsonPair* pairs;
+    Arena arena;
+};
+
+static void parse_job(void* arg) {
+    ParseJob* job = (ParseJob*)arg;
+
+    Parser p;
+    parser_init(&p, job->start, &job->arena, job->in_situ);
+
+    for (uint32_t i = 0; i < job->count; ++i) {
+        if (i) {
+            parser_match(&p, TOKEN_COMMA);
+        }
+
+        if (job->pairs) {
+            Token name_tok = parser_match(&p, TOKEN_STRING);
+            parser_match(&p, TOKEN_COLON);
+
+            JsonPair* pair = job->pairs + i;
+            pair->name = extract_string(&p, name_tok);
+            pair->hash = hash_string(name_tok.ptr + 1, name_tok.len - 2);
+            parse_unknown(&p, &pair->value);
+        }
+        else {
+            parse_unknown(&p, job->elements + i);
+        }
+    }
+
+    parser_free(&p);
+}
+
+JsonDoc* json_doc_parse_parallel(JobSystem* js, char* str, int flags) {
+    int thread_count = jobs_thread_count(js);
+
     Scanner s;
     s.ptr = str;
     s.line = 1;
+    skip_whitespace(&s);
 
-    Json* j= parse_unknown(&s);
-    match_token(&s, TOKEN_EOF);
+    char* open = s.ptr;
+    if (thread_count <= 1 || (*open != '[' && *open != '{')) {
+        return json_doc_parse(str, flags);
+    }
 
-    return j;
+    ParserStack starts = {};
+    char* close = split_top_level(open, &starts);
+    char** member_starts = (char**)starts.data;
+
+    uint32_t member_count = starts.count;
+    if (member_count == 1) {
+        Scanner empty;
+        empty.ptr = member_starts[0];
+        skip_whitespace(&empty);
+        member_count = empty.ptr == close ? 0 : 1;
+    }
+
+    size_t content_len = close - open;
+    size_t max_threads = content_len / JSON_PARALLEL_MIN_BYTES + 1;
+
+    if ((size_t)thread_count > max_threads) {
+        thread_count = (int)max_threads;
+    }
+    if ((uint32_t)thread_count > member_count) {
+        thread_count = (int)member_count;
+    }
+
+    if (thread_count <= 1) {
+        free(starts.data);
+        return json_doc_parse(str, flags);
+    }
+
+    bool in_situ = (flags & JSON_PARSE_IN_SITU) != 0;
+    bool is_object = *open == '{';
+
+    Arena arena;
+    arena_init(&arena, JSON_DOC_BLOCK_SIZE);
+
+    JsonDoc* doc = ARENA_PUSH_STRUCT(&arena, JsonDoc);
+    doc->root = ARENA_PUSH_STRUCT(&arena, Json);
+    doc->source = in_situ && !(flags & JSON_PARSE_BORROW_SOURCE) ? str : NULL;
+
+    Json* root = doc->root;
+    root->type = is_object ? JSON_OBJECT : JSON_ARRAY;
+    root->len = member_count;
+
+    if (is_object) {
+        root->obj = ARENA_PUSH_ARRAY(&arena, JsonPair, member_count);
+    }
+    else {
+        root->arr = ARENA_PUSH_ARRAY(&arena, Json, member_count);
+    }
+
+    // Members are handed out in runs of roughly equal byte size. Every job parses into its own arena
+    // and writes only its own slots, and in-situ termination only touches bytes inside its run.
+    ParseJob* jobs = (ParseJob*)calloc(thread_count, sizeof(ParseJob));
+
+    uint32_t first = 0;
+    for (int t = 0; t < thread_count; ++t) {
+        uint32_t last = first + 1;
+        size_t target = content_len * (t + 1) / thread_count;
+
+        while (last < member_count && (t == thread_count - 1 || (size_t)(member_starts[last] - open) <= target)) {
+            ++last;
+        }
+
+        // Leave at least one member for each of the remaining jobs.
+        uint32_t reserve = (uint32_t)(thread_count - 1 - t);
+        if (last > member_count - reserve) {
+            last = member_count - reserve;
+        }
+
+        ParseJob* job = jobs + t;
+        job->start = member_starts[first];
+        job->count = last - first;
+        job->in_situ = in_situ;
+        job->elements = is_object ? NULL : root->arr + first;
+        job->pairs = is_object ? root->obj + first : NULL;
+        arena_init(&job->arena, JSON_DOC_BLOCK_SIZE);
+
+        first = last;
+    }
+
+    JobCounter parsed = {};
+
+    for (int t = 0; t < thread_count; ++t) {
+        jobs_run(js, parse_job, jobs + t, &parsed);
+    }
+
+    jobs_wait(js, &parsed);
+
+    for (int t = 0; t < thread_count; ++t) {
+        arena_absorb(&arena, &jobs[t].arena);
+    }
+
+    free(jobs);
+    free(starts.data);
+
+    Parser p;
+    parser_init(&p, close, &arena, in_situ);
+    parser_match(&p, is_object ? TOKEN_RBRACE : TOKEN_RSQUARE);
+    parser_match(&p, TOKEN_EOF);
+
+    if (is_object && root->len >= JSON_INDEX_THRESHOLD) {
+        root->obj_index = build_index(&p, root->obj, root->len);
+    }
+
+    parser_free(&p);
+
+    doc->arena = arena;
+
+    return doc;
 }
 
-void json_free(Json* j) {
+JsonDoc* json_doc_parse_member(char* str, char* name) {
+    Scanner s;
+    s.ptr = str;
+    s.line = 1;
+    skip_whitespace(&s);
+
+    if (*s.ptr != '{') {
+        return NULL;
+    }
+
+    ParserStack starts = {};
+    split_top_level(s.ptr, &starts);
+
+    size_t name_len = strlen(name);
+    char* value = NULL;
+
+    for (uint32_t i = 0; i < starts.count && !value; ++i) {
+        s.ptr = ((char**)starts.data)[i];
+        skip_whitespace(&s);
+
+        if (*s.ptr != '"') {
+            break;
+        }
+
+        char* key = s.ptr + 1;
+        s.ptr = key;
+        skip_string_body(&s);
+
+        if ((size_t)(s.ptr - key) == name_len && memcmp(key, name, name_len) == 0) {
+            s.ptr++;
+            skip_whitespace(&s);
+            assert(*s.ptr == ':' && "bad json");
+            value = s.ptr + 1;
+        }
+    }
+
+    free(starts.data);
+
+    if (!value) {
+        return NULL;
+    }
+
+    Arena arena;
+    arena_init(&arena, JSON_DOC_BLOCK_SIZE);
+
+    JsonDoc* doc = ARENA_PUSH_STRUCT(&arena, JsonDoc);
+
+    Parser p;
+    parser_init(&p, value, &arena, false);
+
+    doc->root = (Json*)parser_alloc(&p, sizeof(Json));
+    parse_unknown(&p, doc->root);
+
+    parser_free(&p);
+
+    doc->source = NULL;
+    doc->arena = arena;
+
+    return doc;
+}
+
+void json_doc_free(JsonDoc* doc) {
+    free(doc->source);
+
+    Arena arena = doc->arena;
+    arena_free(&arena);
+}
+
+static void free_children(Json* j) {
     switch (j->type) {
         case JSON_STRING:
             free(j->string);
             break;
         case JSON_ARRAY:
-            for (Json* e = j->arr_first; e;) {
-                Json* next = e->next;
-                json_free(e);
-                e = next;
+            for (uint32_t i = 0; i < j->len; ++i) {
+                free_children(j->arr + i);
             }
+            free(j->arr);
             break;
         case JSON_OBJECT: {
-            for (JsonPair* p = j->obj_first; p;) {
-                JsonPair* next = p->next;
-                free(p->name);
-                json_free(p->json);
-                free(p);
-                p = next;
+            for (uint32_t i = 0; i < j->len; ++i) {
+                free(j->obj[i].name);
+                free_children(&j->obj[i].value);
             }
+            free(j->obj);
+            free(j->obj_index);
             break;
         };
     }
+}
 
+void json_free(Json* j) {
+    free_children(j);
     free(j);
 }
 
-static Json* search_entry(Json* j, char* name) {
+static Json* search_entry(Json* j, JsonKey key) {
     assert(j->type == JSON_OBJECT);
 
-    for (JsonPair* pair = j->obj_first; pair; pair = pair->next) {
-        if (strcmp(pair->name, name) == 0) {
-            return pair->json;
+    if (j->obj_index) {
+        JsonIndex* index = j->obj_index;
+        for (uint32_t i = key.hash & index->mask; index->slots[i]; i = (i + 1) & index->mask) {
+            if (pair_matches(index->slots[i], key)) {
+                return &index->slots[i]->value;
+            }
+        }
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < j->len; ++i) {
+        if (pair_matches(j->obj + i, key)) {
+            return &j->obj[i].value;
         }
     }
 
     return NULL;
 }
 
+JsonKey json_key(char* name) {
+    JsonKey key;
+    key.name = name;
+    key.hash = hash_string(name, strlen(name));
+    return key;
+}
+
 Json* json_lookup(Json* j, char* name) {
-    Json* e = search_entry(j, name);
+    return json_lookup_key(j, json_key(name));
+}
+
+bool json_has(Json* j, char* name) {
+    return json_has_key(j, json_key(name));
+}
+
+Json* json_lookup_key(Json* j, JsonKey key) {
+    Json* e = search_entry(j, key);
     assert(e);
     return e;
 }
 
-bool json_has(Json* j, char* name) {
-    return search_entry(j, name) != NULL;
+bool json_has_key(Json* j, JsonKey key) {
+    return search_entry(j, key) != NULL;
 }
 
 float json_number(Json* j) {
+    assert(j->type == JSON_NUMBER);
+    return (float)j->number;
+}
+
+double json_f64(Json* j) {
     assert(j->type == JSON_NUMBER);
     return j->number;
 }
 
+int64_t json_i64(Json* j) {
+    assert(j->type == JSON_NUMBER);
+    assert((double)j->integer == j->number && "not an integer");
+    return j->integer;
+}
+
+uint64_t json_u64(Json* j) {
+    int64_t i = json_i64(j);
+    assert(i >= 0);
+    return (uint64_t)i;
+}
+
 char* json_string(Json* j) {
     assert(j->type == JSON_STRING);
     return j->string;
 }
 
+size_t json_string_len(Json* j) {
+    assert(j->type == JSON_STRING);
+    return j->len;
+}
+
 bool json_boolean(Json* j) {
     assert(j->type == JSON_BOOLEAN);
     return j->boolean;
 }
 
 int json_array_len(Json* j) {
-    int l = 0;
-    for (Json* e = j->arr_first; e; e = e->next) {
-        ++l;
+    assert(j->type == JSON_ARRAY);
+    return (int)j->len;
+}
+
+Json* json_array_at(Json* j, int i) {
+    assert(j->type == JSON_ARRAY);
+    assert(i >= 0 && (uint32_t)i < j->len);
+    return j->arr + i;
+}
+
+enum ReaderState {
+    READER_VALUE,
+    READER_FIRST_VALUE_OR_END,
+    READER_FIRST_KEY_OR_END,
+    READER_KEY,
+    READER_COLON,
+    READER_COMMA_OR_END,
+    READER_DONE,
+};
+
+struct JsonReader {
+    char* buf;
+    size_t len;
+    size_t cap;
+    size_t pos;
+    size_t wait_from;
+    bool finished;
+
+    ReaderState state;
+    ParserStack containers;
+};
+
+JsonReader* json_reader_create() {
+    JsonReader* r = (JsonReader*)calloc(1, sizeof(JsonReader));
+    r->state = READER_VALUE;
+    return r;
+}
+
+void json_reader_free(JsonReader* r) {
+    free(r->containers.data);
+    free(r->buf);
+    free(r);
+}
+
+void json_reader_feed(JsonReader* r, char* data, size_t len) {
+    assert(!r->finished);
+
+    // Everything before pos has been handed out already, so drop it before growing.
+    if (r->pos) {
+        r->len -= r->pos;
+        memmove(r->buf, r->buf + r->pos, r->len);
+        r->wait_from -= r->wait_from ? r->pos : 0;
+        r->pos = 0;
+    }
+
+    if (r->len + len + 1 > r->cap) {
+        r->cap = r->len + len + 1;
+        r->buf = (char*)realloc(r->buf, r->cap);
+        assert(r->buf && "out of memory");
+    }
+
+    memcpy(r->buf + r->len, data, len);
+    r->len += len;
+    r->buf[r->len] = '\0';
+}
+
+void json_reader_finish(JsonReader* r) {
+    r->finished = true;
+}
+
+// Returns false if the token might still continue in a chunk that hasn't arrived.
+static bool reader_scan(JsonReader* r, Token* o_tok) {
+    if (!r->buf) {
+        memset(o_tok, 0, sizeof(*o_tok));
+        o_tok->type = TOKEN_EOF;
+        return r->finished;
+    }
+
+    // A string split across chunks can be megabytes long, so only rescan it once its closing quote may have arrived.
+    if (r->wait_from && !r->finished) {
+        if (!memchr(r->buf + r->wait_from, '"', r->len - r->wait_from)) {
+            r->wait_from = r->len;
+            return false;
+        }
+    }
+    r->wait_from = 0;
+
+    Scanner s;
+    s.ptr = r->buf + r->pos;
+    s.line = 0;
+
+    *o_tok = scan(&s);
+
+    if (!r->finished) {
+        char* end = r->buf + r->len;
+
+        switch (o_tok->type) {
+            case TOKEN_EOF:
+                return false;
+            case TOKEN_NUMBER:
+                if (s.ptr == end) {
+                    return false;
+                }
+                break;
+            case TOKEN_ERROR:
+                if (*o_tok->ptr == '"' && s.ptr == end) {
+                    r->wait_from = r->len;
+                    return false;
+                }
+                if ((size_t)(end - o_tok->ptr) < strlen("false")) {
+                    return false;
+                }
+                break;
+        }
+    }
+
+    return true;
+}
+
+static void reader_consume(JsonReader* r, Token tok) {
+    r->pos = (tok.ptr - r->buf) + tok.len;
+}
+
+static char reader_top(JsonReader* r) {
+    return ((char*)r->containers.data)[r->containers.count - 1];
+}
+
+static void reader_end_value(JsonReader* r) {
+    r->state = r->containers.count ? READER_COMMA_OR_END : READER_DONE;
+}
+
+static JsonEvent reader_event(JsonReader* r, JsonEventType type) {
+    JsonEvent e = {};
+    e.type = type;
+    e.depth = (int)r->containers.count;
+    return e;
+}
+
+static JsonEvent reader_open(JsonReader* r, char c) {
+    *(char*)stack_push(&r->containers, 1) = c;
+    r->state = c == '[' ? READER_FIRST_VALUE_OR_END : READER_FIRST_KEY_OR_END;
+    return reader_event(r, c == '[' ? JSON_EVENT_BEGIN_ARRAY : JSON_EVENT_BEGIN_OBJECT);
+}
+
+static JsonEvent reader_close(JsonReader* r) {
+    JsonEvent e = reader_event(r, reader_top(r) == '[' ? JSON_EVENT_END_ARRAY : JSON_EVENT_END_OBJECT);
+    --r->containers.count;
+    reader_end_value(r);
+    return e;
+}
+
+static JsonEvent reader_value(JsonReader* r, Token tok) {
+    JsonEvent e = reader_event(r, JSON_EVENT_VALUE);
+
+    switch (tok.type) {
+        case TOKEN_NULL:
+            e.value.type = JSON_NULL;
+            break;
+        case TOKEN_NUMBER:
+            e.value.type = JSON_NUMBER;
+            parse_number(tok, &e.value);
+            break;
+        case TOKEN_STRING:
+            e.value.type = JSON_STRING;
+            tok.ptr[tok.len - 1] = '\0';
+            e.value.string = tok.ptr + 1;
+            e.value.len = tok.len - 2;
+            break;
+        case TOKEN_TRUE:
+        case TOKEN_FALSE:
+            e.value.type = JSON_BOOLEAN;
+            e.value.boolean = tok.type == TOKEN_TRUE;
+            break;
+        case TOKEN_LSQUARE:
+            return reader_open(r, '[');
+        case TOKEN_LBRACE:
+            return reader_open(r, '{');
+        default:
+            return reader_event(r, JSON_EVENT_ERROR);
     }
-    return l;
+
+    reader_end_value(r);
+    return e;
+}
+
+JsonEvent json_reader_next(JsonReader* r) {
+    for (;;) {
+        Token tok;
+        if (!reader_scan(r, &tok)) {
+            return reader_event(r, JSON_EVENT_NEED_MORE);
+        }
+
+        switch (r->state) {
+            case READER_FIRST_VALUE_OR_END:
+                if (tok.type == TOKEN_RSQUARE) {
+                    reader_consume(r, tok);
+                    return reader_close(r);
+                }
+                // fallthrough
+            case READER_VALUE: {
+                JsonEvent e = reader_value(r, tok);
+                if (e.type != JSON_EVENT_ERROR) {
+                    reader_consume(r, tok);
+                }
+                return e;
+            };
+
+            case READER_FIRST_KEY_OR_END:
+                if (tok.type == TOKEN_RBRACE) {
+                    reader_consume(r, tok);
+                    return reader_close(r);
+                }
+                // fallthrough
+            case READER_KEY: {
+                if (tok.type != TOKEN_STRING) {
+                    return reader_event(r, JSON_EVENT_ERROR);
+                }
+
+                reader_consume(r, tok);
+                r->state = READER_COLON;
+
+                JsonEvent e = reader_event(r, JSON_EVENT_KEY);
+                tok.ptr[tok.len - 1] = '\0';
+                e.key = tok.ptr + 1;
+                return e;
+            };
+
+            case READER_COLON:
+                if (tok.type != TOKEN_COLON) {
+                    return reader_event(r, JSON_EVENT_ERROR);
+                }
+
+                reader_consume(r, tok);
+                r->state = READER_VALUE;
+                break;
+
+            case READER_COMMA_OR_END: {
+                char top = reader_top(r);
+
+                if (tok.type == TOKEN_COMMA) {
+                    reader_consume(r, tok);
+                    r->state = top == '[' ? READER_VALUE : READER_KEY;
+                    break;
+                }
+
+                if ((top == '[' && tok.type == TOKEN_RSQUARE) || (top == '{' && tok.type == TOKEN_RBRACE)) {
+                    reader_consume(r, tok);
+                    return reader_close(r);
+                }
+
+                return reader_event(r, JSON_EVENT_ERROR);
+            };
+
+            case READER_DONE:
+                return reader_event(r, tok.type == TOKEN_EOF ? JSON_EVENT_END : JSON_EVENT_ERROR);
+        }
+    }
+}
+
+size_t json_reader_memory(JsonReader* r) {
+    return sizeof(JsonReader) + r->cap + r->containers.cap;
 }
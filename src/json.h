@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.h"
+#include "arena.h"
+#include "jobs.h"
 
 enum JsonType {
     JSON_NULL,
@@ -11,37 +13,126 @@ enum JsonType {
     JSON_OBJECT,
 };
 
-struct Json;
-
-struct JsonPair {
-    char* name;
-    Json* json;
-    JsonPair* next;
-};
+struct JsonPair;
+struct JsonIndex;
 
+// Array elements and object pairs are stored as contiguous spans of len entries, and strings keep their byte length in len.
+// Numbers keep the nearest double, and integer holds the exact value whenever the number is integral and fits in an int64.
 struct Json {
     JsonType type;
+    uint32_t len;
     union {
-        float number;
+        double number;
         char* string;
         bool boolean;
-        Json* arr_first;
-        JsonPair* obj_first;
+        Json* arr;
+        JsonPair* obj;
     };
-    Json* next;
+    union {
+        int64_t integer;
+        JsonIndex* obj_index;
+    };
+};
+
+struct JsonPair {
+    char* name;
+    uint32_t hash;
+    Json value;
+};
+
+// A key with its hash precomputed, so loaders can hash constant field names once.
+struct JsonKey {
+    char* name;
+    uint32_t hash;
+};
+
+enum JsonParseFlags {
+    JSON_PARSE_IN_SITU = 1 << 0,
+    JSON_PARSE_BORROW_SOURCE = 1 << 1,
+};
+
+// Every node, pair and string of a document lives in its one arena, so it is released with a single json_doc_free.
+// With JSON_PARSE_IN_SITU, strings are terminated inside the source buffer instead of copied,
+// and the document takes ownership of that buffer unless JSON_PARSE_BORROW_SOURCE is also given (e.g. for mapped files).
+struct JsonDoc {
+    Json* root;
+    char* source;
+    Arena arena;
 };
 
 Json* json_parse(char* str);
 void json_free(Json* j);
 
+JsonDoc* json_doc_parse(char* str, int flags);
+
+// Splits the members of the top-level array or object into one run per worker of js, parses the runs as jobs,
+// and stitches them into the same tree json_doc_parse would build. Small documents are parsed serially.
+JsonDoc* json_doc_parse_parallel(JobSystem* js, char* str, int flags);
+
+// Parses only the value of the top-level object member called name, finding it with the structural scan
+// rather than a full parse, so a loader can act on one section before parsing the rest. Strings are copied
+// and str is left untouched. Keys are compared unescaped. Returns NULL if there is no such member.
+JsonDoc* json_doc_parse_member(char* str, char* name);
+void json_doc_free(JsonDoc* doc);
+
+JsonKey json_key(char* name);
+
 Json* json_lookup(Json* j, char* name);
 bool json_has(Json* j, char* name);
 
+Json* json_lookup_key(Json* j, JsonKey key);
+bool json_has_key(Json* j, JsonKey key);
+
 float json_number(Json* j);
+double json_f64(Json* j);
+int64_t json_i64(Json* j);
+uint64_t json_u64(Json* j);
 char* json_string(Json* j);
+size_t json_string_len(Json* j);
 bool json_boolean(Json* j);
 
 int json_array_len(Json* j);
+Json* json_array_at(Json* j, int i);
+
+#define JSON_ARRAY_FOR(list, el) assert((list)->type == JSON_ARRAY); \
+                                 for (Json *el = (list)->arr, *el##_end = el + (list)->len; el != el##_end; ++el)
+
+#define JSON_OBJECT_FOR(object, pair) assert((object)->type == JSON_OBJECT); \
+                                      for (JsonPair *pair = (object)->obj, *pair##_end = pair + (object)->len; pair != pair##_end; ++pair)
+
+// Pull reader that parses incrementally from chunks without building a tree.
+// Feed it input as it arrives and pull events until it asks for more;
+// after the last chunk, json_reader_finish lets it resolve the trailing token.
+// Key and string events point into the reader's buffer and stay valid until the next json_reader_feed.
+
+enum JsonEventType {
+    JSON_EVENT_ERROR,
+    JSON_EVENT_NEED_MORE,
+    JSON_EVENT_END,
+    JSON_EVENT_BEGIN_OBJECT,
+    JSON_EVENT_END_OBJECT,
+    JSON_EVENT_BEGIN_ARRAY,
+    JSON_EVENT_END_ARRAY,
+    JSON_EVENT_KEY,
+    JSON_EVENT_VALUE,
+};
+
+struct JsonEvent {
+    JsonEventType type;
+    char* key;
+    Json value;
+    int depth;
+};
+
+struct JsonReader;
+
+JsonReader* json_reader_create();
+void json_reader_free(JsonReader* r);
+
+void json_reader_feed(JsonReader* r, char* data, size_t len);
+void json_reader_finish(JsonReader* r);
+
+JsonEvent json_reader_next(JsonReader* r);
 
-#define JSON_ARRAY_FOR(arr, el) assert(arr->type == JSON_ARRAY); \
-                                for (Json* el = arr->arr_first; el; el = el->next)
+// Bytes the reader holds. Its buffer and stack never shrink, so this is also its peak.
+size_t json_reader_memory(JsonReader* r);
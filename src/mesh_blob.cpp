@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh_blob.h"
+
+#define ALIGN_UP(x, a) (((x) + ((a) - 1)) & ~(uint64_t)((a) - 1))
+
+struct MeshBlobBuilder {
+    MeshBlobMesh* meshes;
+    uint32_t mesh_count;
+    uint32_t mesh_cap;
+};
+
+MeshBlobBuilder* mesh_blob_builder_create() {
+    return (MeshBlobBuilder*)calloc(1, sizeof(MeshBlobBuilder));
+}
+
+void mesh_blob_builder_free(MeshBlobBuilder* b) {
+    for (uint32_t i = 0; i < b->mesh_count; ++i) {
+        free(b->meshes[i].vertices);
+        free(b->meshes[i].indices);
+    }
+
+    free(b->meshes);
+    free(b);
+}
+
+void mesh_blob_add(MeshBlobBuilder* b, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    if (b->mesh_count == b->mesh_cap) {
+        b->mesh_cap = b->mesh_cap ? b->mesh_cap * 2 : 16;
+        b->meshes = (MeshBlobMesh*)realloc(b->meshes, b->mesh_cap * sizeof(MeshBlobMesh));
+    }
+
+    MeshBlobMesh* mesh = b->meshes + b->mesh_count++;
+
+    mesh->vertex_count = vertex_count;
+    mesh->vertices = (RDMeshVertex*)malloc(vertex_count * sizeof(RDMeshVertex));
+    memcpy(mesh->vertices, vertex_data, vertex_count * sizeof(RDMeshVertex));
+
+    mesh->index_count = index_count;
+    mesh->indices = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    memcpy(mesh->indices, index_data, index_count * sizeof(uint32_t));
+}
+
+void* mesh_blob_build(MeshBlobBuilder* b, size_t* o_size) {
+    uint64_t size = sizeof(MeshBlobHeader) + b->mesh_count * sizeof(MeshBlobEntry);
+
+    for (uint32_t i = 0; i < b->mesh_count; ++i) {
+        size = ALIGN_UP(size, MESH_BLOB_ALIGNMENT) + b->meshes[i].vertex_count * sizeof(RDMeshVertex);
+        size = ALIGN_UP(size, MESH_BLOB_ALIGNMENT) + b->meshes[i].index_count * sizeof(uint32_t);
+    }
+
+    char* data = (char*)calloc(1, size);
+
+    MeshBlobHeader* header = (MeshBlobHeader*)data;
+    header->magic = MESH_BLOB_MAGIC;
+    header->version = MESH_BLOB_VERSION;
+    header->mesh_count = b->mesh_count;
+    header->vertex_size = sizeof(RDMeshVertex);
+    header->size = size;
+
+    MeshBlobEntry* entries = (MeshBlobEntry*)(header + 1);
+    uint64_t offset = sizeof(MeshBlobHeader) + b->mesh_count * sizeof(MeshBlobEntry);
+
+    for (uint32_t i = 0; i < b->mesh_count; ++i) {
+        MeshBlobMesh* mesh = b->meshes + i;
+        MeshBlobEntry* entry = entries + i;
+
+        entry->vertex_count = mesh->vertex_count;
+        entry->index_count = mesh->index_count;
+
+        offset = ALIGN_UP(offset, MESH_BLOB_ALIGNMENT);
+        entry->vertex_offset = offset;
+        memcpy(data + offset, mesh->vertices, mesh->vertex_count * sizeof(RDMeshVertex));
+        offset += mesh->vertex_count * sizeof(RDMeshVertex);
+
+        offset = ALIGN_UP(offset, MESH_BLOB_ALIGNMENT);
+        entry->index_offset = offset;
+        memcpy(data + offset, mesh->indices, mesh->index_count * sizeof(uint32_t));
+        offset += mesh->index_count * sizeof(uint32_t);
+    }
+
+    assert(offset == size);
+
+    if (o_size) {
+        *o_size = (size_t)size;
+    }
+
+    return data;
+}
+
+static bool range_valid(uint64_t offset, uint64_t len, uint64_t size) {
+    return offset % MESH_BLOB_ALIGNMENT == 0 && offset <= size && len <= size - offset;
+}
+
+MeshBlob* mesh_blob_open(char* path) {
+    if (!file_exists(path)) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    char* data = map_file(path, &size);
+
+    MeshBlobHeader* header = (MeshBlobHeader*)data;
+
+    bool valid = size >= sizeof(MeshBlobHeader) &&
+                 header->magic == MESH_BLOB_MAGIC &&
+                 header->version == MESH_BLOB_VERSION &&
+                 header->vertex_size == sizeof(RDMeshVertex) &&
+                 header->size == size &&
+                 header->mesh_count <= (size - sizeof(MeshBlobHeader)) / sizeof(MeshBlobEntry);
+
+    MeshBlobEntry* entries = (MeshBlobEntry*)(header + 1);
+
+    for (uint32_t i = 0; valid && i < header->mesh_count; ++i) {
+        MeshBlobEntry* entry = entries + i;
+        valid = range_valid(entry->vertex_offset, (uint64_t)entry->vertex_count * sizeof(RDMeshVertex), size) &&
+                range_valid(entry->index_offset, (uint64_t)entry->index_count * sizeof(uint32_t), size);
+    }
+
+    if (!valid) {
+        unmap_file(data, size);
+        return NULL;
+    }
+
+    MeshBlob* blob = (MeshBlob*)calloc(1, sizeof(MeshBlob));
+    blob->data = data;
+    blob->size = size;
+    blob->header = header;
+    blob->entries = entries;
+
+    return blob;
+}
+
+void mesh_blob_close(MeshBlob* blob) {
+    unmap_file(blob->data, blob->size);
+    free(blob);
+}
+
+uint32_t mesh_blob_count(MeshBlob* blob) {
+    return blob->header->mesh_count;
+}
+
+MeshBlobMesh mesh_blob_mesh(MeshBlob* blob, uint32_t index) {
+    assert(index < blob->header->mesh_count);
+    MeshBlobEntry* entry = blob->entries + index;
+
+    MeshBlobMesh mesh;
+    mesh.vertices = (RDMeshVertex*)(blob->data + entry->vertex_offset);
+    mesh.vertex_count = entry->vertex_count;
+    mesh.indices = (uint32_t*)(blob->data + entry->index_offset);
+    mesh.index_count = entry->index_count;
+
+    return mesh;
+}
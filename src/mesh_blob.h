@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common.h"
+#include "renderer.h"
+
+// Cooked mesh file: a header, a table of meshes, then every vertex and index array
+// laid out exactly as rd_add_mesh takes them, each aligned to MESH_BLOB_ALIGNMENT.
+// Offsets are from the start of the file, and everything is little-endian.
+
+#define MESH_BLOB_MAGIC 0x424D5A44 // "DZMB"
+#define MESH_BLOB_VERSION 1
+#define MESH_BLOB_ALIGNMENT 64
+
+struct MeshBlobHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t mesh_count;
+    uint32_t vertex_size;
+    uint64_t size;
+};
+
+struct MeshBlobEntry {
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    uint32_t vertex_count;
+    uint32_t index_count;
+};
+
+struct MeshBlobMesh {
+    RDMeshVertex* vertices;
+    uint32_t vertex_count;
+    uint32_t* indices;
+    uint32_t index_count;
+};
+
+struct MeshBlobBuilder;
+
+MeshBlobBuilder* mesh_blob_builder_create();
+void mesh_blob_builder_free(MeshBlobBuilder* b);
+
+// Copies the mesh, so the arrays can be freed once this returns.
+void mesh_blob_add(MeshBlobBuilder* b, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count);
+
+// Returns the finished file image, allocated with malloc.
+void* mesh_blob_build(MeshBlobBuilder* b, size_t* o_size);
+
+struct MeshBlob {
+    char* data;
+    size_t size;
+    MeshBlobHeader* header;
+    MeshBlobEntry* entries;
+};
+
+// Maps a cooked file. Returns NULL if it is missing, from another version, or malformed, so callers can fall back to the source asset.
+MeshBlob* mesh_blob_open(char* path);
+void mesh_blob_close(MeshBlob* blob);
+
+uint32_t mesh_blob_count(MeshBlob* blob);
+
+// Pointers into the mapping; valid until mesh_blob_close.
+MeshBlobMesh mesh_blob_mesh(MeshBlob* blob, uint32_t index);
@@ -0,0 +1,440 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "mesh_opt.h"
+
+// Cache positions and valences past these score the same as the last entry.
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 32
+
+// How far a cluster's ACMR may exceed the whole mesh's before optimize_mesh stops splitting for overdraw.
+#define OVERDRAW_THRESHOLD 1.05f
+
+// Simulates a FIFO cache by stamping each vertex with the miss counter when it enters.
+// A vertex is still cached if fewer than MESH_OPT_FIFO_SIZE misses happened since. Returns 1 on a miss.
+static uint32_t fifo_touch(uint32_t* stamps, uint32_t* time, uint32_t v) {
+    if (*time - stamps[v] > MESH_OPT_FIFO_SIZE) {
+        stamps[v] = (*time)++;
+        return 1;
+    }
+    return 0;
+}
+
+MeshOptStats mesh_opt_analyze(uint32_t* index_data, uint32_t index_count, uint32_t vertex_count) {
+    MeshOptStats stats = {};
+    stats.triangle_count = index_count / 3;
+
+    uint32_t* stamps = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    uint32_t time = MESH_OPT_FIFO_SIZE + 1;
+
+    for (uint32_t i = 0; i < stats.triangle_count * 3; ++i) {
+        uint32_t v = index_data[i];
+        assert(v < vertex_count);
+
+        stats.vertex_count += stamps[v] == 0;
+        stats.transform_count += fifo_touch(stamps, &time, v);
+    }
+
+    free(stamps);
+
+    return stats;
+}
+
+float mesh_opt_acmr(MeshOptStats stats) {
+    return stats.triangle_count ? (float)stats.transform_count / (float)stats.triangle_count : 0.0f;
+}
+
+float mesh_opt_atvr(MeshOptStats stats) {
+    return stats.vertex_count ? (float)stats.transform_count / (float)stats.vertex_count : 0.0f;
+}
+
+struct ForsythTables {
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_MAX_VALENCE];
+};
+
+static void forsyth_tables(ForsythTables* t) {
+    for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+        // The last triangle's vertices score the same regardless of order, so it isn't favoured to repeat.
+        t->cache[i] = i < 3 ? 0.75f : powf(1.0f - (float)(i - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Vertices with few triangles left are boosted, so they get finished off instead of stranded.
+    t->valence[0] = 0.0f;
+    for (int i = 1; i < FORSYTH_MAX_VALENCE; ++i) {
+        t->valence[i] = 2.0f / sqrtf((float)i);
+    }
+}
+
+static float vertex_score(ForsythTables* t, int cache_pos, uint32_t remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+
+    float score = cache_pos >= 0 ? t->cache[cache_pos] : 0.0f;
+    return score + t->valence[remaining < FORSYTH_MAX_VALENCE ? remaining : FORSYTH_MAX_VALENCE - 1];
+}
+
+void mesh_opt_vertex_cache(uint32_t* index_data, uint32_t index_count, uint32_t vertex_count) {
+    uint32_t tri_count = index_count / 3;
+    if (tri_count == 0) {
+        return;
+    }
+
+    ForsythTables tables;
+    forsyth_tables(&tables);
+
+    // Triangles using each vertex. Emitted triangles are swapped out, so the first remaining[v] entries are the live ones.
+    uint32_t* remaining = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    uint32_t* offsets = (uint32_t*)malloc((vertex_count + 1) * sizeof(uint32_t));
+    uint32_t* adjacency = (uint32_t*)malloc(tri_count * 3 * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < tri_count * 3; ++i) {
+        assert(index_data[i] < vertex_count);
+        remaining[index_data[i]]++;
+    }
+
+    offsets[0] = 0;
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+        remaining[v] = 0;
+    }
+
+    for (uint32_t i = 0; i < tri_count * 3; ++i) {
+        uint32_t v = index_data[i];
+        adjacency[offsets[v] + remaining[v]++] = i / 3;
+    }
+
+    int* cache_pos = (int*)malloc(vertex_count * sizeof(int));
+    float* scores = (float*)malloc(vertex_count * sizeof(float));
+
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        cache_pos[v] = -1;
+        scores[v] = vertex_score(&tables, -1, remaining[v]);
+    }
+
+    bool* emitted = (bool*)calloc(tri_count, sizeof(bool));
+    uint32_t* out = (uint32_t*)malloc(tri_count * 3 * sizeof(uint32_t));
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cache_count = 0;
+
+    int best = -1;
+    float best_score = -1.0f;
+
+    for (uint32_t t = 0; t < tri_count; ++t) {
+        uint32_t* tri = index_data + t * 3;
+        float score = scores[tri[0]] + scores[tri[1]] + scores[tri[2]];
+
+        if (score > best_score) {
+            best = (int)t;
+            best_score = score;
+        }
+    }
+
+    uint32_t cursor = 0;
+
+    for (uint32_t out_tri = 0; out_tri < tri_count; ++out_tri) {
+        // Nothing in the cache has triangles left, so restart from the next one in input order.
+        if (best < 0) {
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = (int)cursor;
+        }
+
+        uint32_t* tri = index_data + best * 3;
+        emitted[best] = true;
+        memcpy(out + out_tri * 3, tri, 3 * sizeof(uint32_t));
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = tri[k];
+            uint32_t* adj = adjacency + offsets[v];
+
+            for (uint32_t j = 0; j < remaining[v]; ++j) {
+                if (adj[j] == (uint32_t)best) {
+                    adj[j] = adj[remaining[v] - 1];
+                    break;
+                }
+            }
+
+            remaining[v]--;
+        }
+
+        // The triangle's vertices move to the front, everything else shifts back.
+        uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t new_count = 0;
+
+        for (int k = 0; k < 3; ++k) {
+            if ((k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1])) {
+                new_cache[new_count++] = tri[k];
+            }
+        }
+
+        for (uint32_t j = 0; j < cache_count; ++j) {
+            uint32_t v = cache[j];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        for (uint32_t j = 0; j < new_count; ++j) {
+            uint32_t v = new_cache[j];
+            cache_pos[v] = j < FORSYTH_CACHE_SIZE ? (int)j : -1;
+            scores[v] = vertex_score(&tables, cache_pos[v], remaining[v]);
+        }
+
+        cache_count = new_count < FORSYTH_CACHE_SIZE ? new_count : FORSYTH_CACHE_SIZE;
+        memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+        // Only triangles touching vertices whose scores changed can become the best.
+        best = -1;
+        best_score = -1.0f;
+
+        for (uint32_t j = 0; j < new_count; ++j) {
+            uint32_t v = new_cache[j];
+            uint32_t* adj = adjacency + offsets[v];
+
+            for (uint32_t a = 0; a < remaining[v]; ++a) {
+                uint32_t* adj_tri = index_data + adj[a] * 3;
+                float score = scores[adj_tri[0]] + scores[adj_tri[1]] + scores[adj_tri[2]];
+
+                if (score > best_score) {
+                    best = (int)adj[a];
+                    best_score = score;
+                }
+            }
+        }
+    }
+
+    memcpy(index_data, out, tri_count * 3 * sizeof(uint32_t));
+
+    free(out);
+    free(emitted);
+    free(scores);
+    free(cache_pos);
+    free(adjacency);
+    free(offsets);
+    free(remaining);
+}
+
+struct OverdrawCluster {
+    float key;
+    uint32_t index;
+};
+
+static int compare_clusters(const void* a, const void* b) {
+    OverdrawCluster* ca = (OverdrawCluster*)a;
+    OverdrawCluster* cb = (OverdrawCluster*)b;
+
+    if (ca->key != cb->key) {
+        return ca->key > cb->key ? -1 : 1;
+    }
+    return ca->index < cb->index ? -1 : 1;
+}
+
+static Float3 sub3(Float3 a, Float3 b) {
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static Float3 cross3(Float3 a, Float3 b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static float dot3(Float3 a, Float3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+void mesh_opt_overdraw(uint32_t* index_data, uint32_t index_count, RDMeshVertex* vertex_data, uint32_t vertex_count, float threshold) {
+    uint32_t tri_count = index_count / 3;
+    if (tri_count < 2) {
+        return;
+    }
+
+    float target = mesh_opt_acmr(mesh_opt_analyze(index_data, index_count, vertex_count)) * threshold;
+
+    uint32_t* cluster_starts = (uint32_t*)malloc((tri_count + 1) * sizeof(uint32_t));
+    uint32_t cluster_count = 0;
+
+    uint32_t* stamps = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    uint32_t time = MESH_OPT_FIFO_SIZE + 1;
+
+    uint32_t cluster_start = 0;
+    uint32_t cluster_misses = 0;
+
+    for (uint32_t t = 0; t < tri_count; ++t) {
+        uint32_t* tri = index_data + t * 3;
+
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            misses += fifo_touch(stamps, &time, tri[k]);
+        }
+
+        // Three misses means the cache restarted here, so splitting costs nothing.
+        if (misses == 3 && t > cluster_start) {
+            cluster_starts[cluster_count++] = cluster_start;
+            cluster_start = t;
+            cluster_misses = 0;
+        }
+
+        cluster_misses += misses;
+
+        // Split once the cluster has amortised its cold start, simulating a cold cache for the next one.
+        if (t + 1 < tri_count && (float)cluster_misses <= target * (float)(t - cluster_start + 1)) {
+            cluster_starts[cluster_count++] = cluster_start;
+            cluster_start = t + 1;
+            cluster_misses = 0;
+            time += MESH_OPT_FIFO_SIZE + 1;
+        }
+    }
+
+    cluster_starts[cluster_count++] = cluster_start;
+    cluster_starts[cluster_count] = tri_count;
+
+    free(stamps);
+
+    if (cluster_count > 1) {
+        Float3* centroids = (Float3*)calloc(cluster_count, sizeof(Float3));
+        Float3* normals = (Float3*)calloc(cluster_count, sizeof(Float3));
+
+        Float3 mesh_centroid = {};
+        float mesh_area = 0.0f;
+
+        for (uint32_t c = 0; c < cluster_count; ++c) {
+            Float3 centroid = {};
+            Float3 normal = {};
+            float area = 0.0f;
+
+            for (uint32_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t) {
+                Float3 p0 = vertex_data[index_data[t * 3 + 0]].pos;
+                Float3 p1 = vertex_data[index_data[t * 3 + 1]].pos;
+                Float3 p2 = vertex_data[index_data[t * 3 + 2]].pos;
+
+                Float3 n = cross3(sub3(p1, p0), sub3(p2, p0));
+                float w = sqrtf(dot3(n, n));
+
+                centroid.x += (p0.x + p1.x + p2.x) * w;
+                centroid.y += (p0.y + p1.y + p2.y) * w;
+                centroid.z += (p0.z + p1.z + p2.z) * w;
+
+                normal.x += n.x;
+                normal.y += n.y;
+                normal.z += n.z;
+
+                area += w;
+            }
+
+            mesh_centroid.x += centroid.x;
+            mesh_centroid.y += centroid.y;
+            mesh_centroid.z += centroid.z;
+            mesh_area += area;
+
+            float inv_area = area > 0.0f ? 1.0f / (area * 3.0f) : 0.0f;
+            centroids[c] = { centroid.x * inv_area, centroid.y * inv_area, centroid.z * inv_area };
+            normals[c] = normal;
+        }
+
+        float inv_mesh_area = mesh_area > 0.0f ? 1.0f / (mesh_area * 3.0f) : 0.0f;
+        mesh_centroid = { mesh_centroid.x * inv_mesh_area, mesh_centroid.y * inv_mesh_area, mesh_centroid.z * inv_mesh_area };
+
+        // Clusters far out along their own normal are likely to occlude the rest, so they draw first.
+        OverdrawCluster* order = (OverdrawCluster*)malloc(cluster_count * sizeof(OverdrawCluster));
+
+        for (uint32_t c = 0; c < cluster_count; ++c) {
+            float len = sqrtf(dot3(normals[c], normals[c]));
+            order[c].key = len > 0.0f ? dot3(sub3(centroids[c], mesh_centroid), normals[c]) / len : 0.0f;
+            order[c].index = c;
+        }
+
+        qsort(order, cluster_count, sizeof(OverdrawCluster), compare_clusters);
+
+        uint32_t* out = (uint32_t*)malloc(tri_count * 3 * sizeof(uint32_t));
+        uint32_t out_count = 0;
+
+        for (uint32_t i = 0; i < cluster_count; ++i) {
+            uint32_t c = order[i].index;
+            uint32_t count = (cluster_starts[c + 1] - cluster_starts[c]) * 3;
+
+            memcpy(out + out_count, index_data + cluster_starts[c] * 3, count * sizeof(uint32_t));
+            out_count += count;
+        }
+
+        memcpy(index_data, out, tri_count * 3 * sizeof(uint32_t));
+
+        free(out);
+        free(order);
+        free(normals);
+        free(centroids);
+    }
+
+    free(cluster_starts);
+}
+
+uint32_t mesh_opt_vertex_fetch(RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    uint32_t* remap = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+    memset(remap, 0xFF, vertex_count * sizeof(uint32_t));
+
+    uint32_t new_count = 0;
+
+    for (uint32_t i = 0; i < index_count; ++i) {
+        uint32_t v = index_data[i];
+        assert(v < vertex_count);
+
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = new_count++;
+        }
+
+        index_data[i] = remap[v];
+    }
+
+    RDMeshVertex* reordered = (RDMeshVertex*)malloc(new_count * sizeof(RDMeshVertex));
+
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        if (remap[v] != UINT32_MAX) {
+            reordered[remap[v]] = vertex_data[v];
+        }
+    }
+
+    memcpy(vertex_data, reordered, new_count * sizeof(RDMeshVertex));
+
+    free(reordered);
+    free(remap);
+
+    return new_count;
+}
+
+uint32_t optimize_mesh(RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count,
+                       MeshOptStats* o_before, MeshOptStats* o_after)
+{
+    // Anything other than a valid triangle list is passed through untouched.
+    bool valid = index_count > 0 && index_count % 3 == 0;
+
+    for (uint32_t i = 0; valid && i < index_count; ++i) {
+        valid = index_data[i] < vertex_count;
+    }
+
+    if (!valid) {
+        if (o_before) {
+            memset(o_before, 0, sizeof(MeshOptStats));
+        }
+        if (o_after) {
+            memset(o_after, 0, sizeof(MeshOptStats));
+        }
+        return vertex_count;
+    }
+
+    if (o_before) {
+        *o_before = mesh_opt_analyze(index_data, index_count, vertex_count);
+    }
+
+    mesh_opt_vertex_cache(index_data, index_count, vertex_count);
+    mesh_opt_overdraw(index_data, index_count, vertex_data, vertex_count, OVERDRAW_THRESHOLD);
+    vertex_count = mesh_opt_vertex_fetch(vertex_data, vertex_count, index_data, index_count);
+
+    if (o_after) {
+        *o_after = mesh_opt_analyze(index_data, index_count, vertex_count);
+    }
+
+    return vertex_count;
+}
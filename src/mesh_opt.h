@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.h"
+#include "renderer.h"
+
+// Import-time reordering of triangle lists, so meshes draw with fewer vertex shader invocations,
+// less overdraw and in-order vertex fetches. Index counts must be a multiple of three.
+
+// Size of the FIFO post-transform cache mesh_opt_analyze simulates.
+#define MESH_OPT_FIFO_SIZE 16
+
+struct MeshOptStats {
+    uint32_t triangle_count;
+    uint32_t vertex_count; // Distinct vertices referenced by the indices.
+    uint32_t transform_count; // Vertex shader invocations, i.e. cache misses.
+};
+
+MeshOptStats mesh_opt_analyze(uint32_t* index_data, uint32_t index_count, uint32_t vertex_count);
+
+// Average cache miss ratio: transforms per triangle. 0.5 is the best possible, 3 means no reuse.
+float mesh_opt_acmr(MeshOptStats stats);
+
+// Average transform to vertex ratio. 1 is the best possible.
+float mesh_opt_atvr(MeshOptStats stats);
+
+// Reorders triangles for the post-transform cache, with Forsyth's linear-speed algorithm.
+void mesh_opt_vertex_cache(uint32_t* index_data, uint32_t index_count, uint32_t vertex_count);
+
+// Splits a cache-ordered list into clusters wherever the cache would restart anyway, or once a cluster's
+// ACMR has fallen to threshold times the mesh's, then sorts the clusters so the outward-facing ones draw first.
+void mesh_opt_overdraw(uint32_t* index_data, uint32_t index_count, RDMeshVertex* vertex_data, uint32_t vertex_count, float threshold);
+
+// Renumbers vertices in order of first use and drops unreferenced ones. Returns the new vertex count.
+uint32_t mesh_opt_vertex_fetch(RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count);
+
+// Runs all three passes and returns the new vertex count. o_before and o_after may be NULL.
+uint32_t optimize_mesh(RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count,
+                       MeshOptStats* o_before, MeshOptStats* o_after);
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh_pool.h"
+
+#define MESH_POOL_CHUNK_SHIFT 10
+#define MESH_POOL_CHUNK_SIZE (1 << MESH_POOL_CHUNK_SHIFT)
+
+#define NOT_LIVE UINT32_MAX
+
+struct RetiringSlot {
+    uint32_t slot;
+    uint64_t fence;
+};
+
+struct MeshPool {
+    uint32_t item_size;
+
+    char** chunks;
+    uint32_t chunk_count;
+
+    // Per slot. Generations start at 1, so a zeroed handle is never valid.
+    uint32_t* generations;
+    uint32_t* dense_index;
+    uint32_t slot_count;
+    uint32_t slot_cap;
+
+    uint32_t* dense;
+    uint32_t dense_count;
+
+    uint32_t* free_slots;
+    uint32_t free_count;
+
+    RetiringSlot* retiring;
+    uint32_t retiring_count;
+    uint32_t retiring_cap;
+};
+
+static void* slot_item(MeshPool* pool, uint32_t slot) {
+    return pool->chunks[slot >> MESH_POOL_CHUNK_SHIFT] + (size_t)(slot & (MESH_POOL_CHUNK_SIZE - 1)) * pool->item_size;
+}
+
+MeshPool* mesh_pool_create(uint32_t item_size) {
+    assert(item_size > 0);
+
+    MeshPool* pool = (MeshPool*)calloc(1, sizeof(MeshPool));
+    pool->item_size = item_size;
+
+    return pool;
+}
+
+void mesh_pool_free(MeshPool* pool) {
+    for (uint32_t i = 0; i < pool->chunk_count; ++i) {
+        free(pool->chunks[i]);
+    }
+
+    free(pool->chunks);
+    free(pool->generations);
+    free(pool->dense_index);
+    free(pool->dense);
+    free(pool->free_slots);
+    free(pool->retiring);
+    free(pool);
+}
+
+static uint32_t new_slot(MeshPool* pool) {
+    if (pool->slot_count == pool->slot_cap) {
+        pool->slot_cap = pool->slot_cap ? pool->slot_cap * 2 : MESH_POOL_CHUNK_SIZE;
+        pool->generations = (uint32_t*)realloc(pool->generations, pool->slot_cap * sizeof(uint32_t));
+        pool->dense_index = (uint32_t*)realloc(pool->dense_index, pool->slot_cap * sizeof(uint32_t));
+        pool->dense = (uint32_t*)realloc(pool->dense, pool->slot_cap * sizeof(uint32_t));
+        pool->free_slots = (uint32_t*)realloc(pool->free_slots, pool->slot_cap * sizeof(uint32_t));
+    }
+
+    uint32_t slot = pool->slot_count++;
+
+    if ((slot >> MESH_POOL_CHUNK_SHIFT) == pool->chunk_count) {
+        pool->chunks = (char**)realloc(pool->chunks, (pool->chunk_count + 1) * sizeof(char*));
+        pool->chunks[pool->chunk_count++] = (char*)malloc((size_t)MESH_POOL_CHUNK_SIZE * pool->item_size);
+    }
+
+    pool->generations[slot] = 1;
+    pool->dense_index[slot] = NOT_LIVE;
+
+    return slot;
+}
+
+RDMesh mesh_pool_add(MeshPool* pool, void** o_item) {
+    // Reuse the most recently freed slot, as its item is most likely still in cache.
+    uint32_t slot = pool->free_count > 0 ? pool->free_slots[--pool->free_count] : new_slot(pool);
+
+    pool->dense_index[slot] = pool->dense_count;
+    pool->dense[pool->dense_count++] = slot;
+
+    void* item = slot_item(pool, slot);
+    memset(item, 0, pool->item_size);
+    *o_item = item;
+
+    RDMesh handle;
+    handle.index = slot;
+    handle.generation = pool->generations[slot];
+
+    return handle;
+}
+
+void* mesh_pool_get(MeshPool* pool, RDMesh handle) {
+    if (handle.index >= pool->slot_count || pool->generations[handle.index] != handle.generation || pool->dense_index[handle.index] == NOT_LIVE) {
+        return NULL;
+    }
+    return slot_item(pool, handle.index);
+}
+
+bool mesh_pool_remove(MeshPool* pool, RDMesh handle, uint64_t retire_fence) {
+    if (!mesh_pool_get(pool, handle)) {
+        return false;
+    }
+
+    uint32_t slot = handle.index;
+
+    uint32_t hole = pool->dense_index[slot];
+    uint32_t last = pool->dense[--pool->dense_count];
+    pool->dense[hole] = last;
+    pool->dense_index[last] = hole;
+    pool->dense_index[slot] = NOT_LIVE;
+
+    // Bumped now rather than on reuse, so the handle goes stale immediately. Zero is skipped on wrap.
+    if (++pool->generations[slot] == 0) {
+        pool->generations[slot] = 1;
+    }
+
+    if (pool->retiring_count == pool->retiring_cap) {
+        pool->retiring_cap = pool->retiring_cap ? pool->retiring_cap * 2 : 64;
+        pool->retiring = (RetiringSlot*)realloc(pool->retiring, pool->retiring_cap * sizeof(RetiringSlot));
+    }
+
+    RetiringSlot* r = pool->retiring + pool->retiring_count++;
+    r->slot = slot;
+    r->fence = retire_fence;
+
+    return true;
+}
+
+void mesh_pool_retire(MeshPool* pool, uint64_t completed_fence, MeshPoolReleaseProc* release, void* user) {
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < pool->retiring_count; ++i) {
+        RetiringSlot r = pool->retiring[i];
+
+        if (r.fence <= completed_fence) {
+            if (release) {
+                release(user, slot_item(pool, r.slot));
+            }
+            pool->free_slots[pool->free_count++] = r.slot;
+        }
+        else {
+            pool->retiring[kept++] = r;
+        }
+    }
+
+    pool->retiring_count = kept;
+}
+
+uint32_t mesh_pool_count(MeshPool* pool) {
+    return pool->dense_count;
+}
+
+void* mesh_pool_item(MeshPool* pool, uint32_t i) {
+    assert(i < pool->dense_count);
+    return slot_item(pool, pool->dense[i]);
+}
+
+uint32_t mesh_pool_slot_count(MeshPool* pool) {
+    return pool->slot_count;
+}
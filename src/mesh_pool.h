@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.h"
+#include "renderer.h"
+
+// Backend-independent registry behind RDMesh handles. Each live mesh owns a fixed-size backend record,
+// stored in chunks so records never move. Handles carry the slot's generation, so a handle to a removed
+// mesh is caught instead of aliasing whatever mesh reuses its slot.
+
+struct MeshPool;
+
+MeshPool* mesh_pool_create(uint32_t item_size);
+
+// Items still live or awaiting retirement are not released; drain them first.
+void mesh_pool_free(MeshPool* pool);
+
+// Returns a zeroed item in *o_item, valid until the mesh is retired.
+RDMesh mesh_pool_add(MeshPool* pool, void** o_item);
+
+// NULL if the handle was removed or never valid.
+void* mesh_pool_get(MeshPool* pool, RDMesh handle);
+
+// Invalidates the handle at once, but keeps the slot out of reuse until mesh_pool_retire is passed a
+// completed fence of at least retire_fence, so frames in flight can keep reading the item.
+// Returns false if the handle was already stale.
+bool mesh_pool_remove(MeshPool* pool, RDMesh handle, uint64_t retire_fence);
+
+typedef void MeshPoolReleaseProc(void* user, void* item);
+
+// Hands every removed item whose fence has completed to release, in removal order, then frees its slot.
+void mesh_pool_retire(MeshPool* pool, uint64_t completed_fence, MeshPoolReleaseProc* release, void* user);
+
+// Live meshes, densely indexed in no particular order. Removal moves the last one into the gap.
+uint32_t mesh_pool_count(MeshPool* pool);
+void* mesh_pool_item(MeshPool* pool, uint32_t i);
+
+// Slots ever created, including free and retiring ones. Handle indices are always below this.
+uint32_t mesh_pool_slot_count(MeshPool* pool);
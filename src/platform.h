@@ -1,7 +1,42 @@
 #pragma once
 
+// Call once at startup, before anything else in the platform layer.
+void platform_init();
+
 void message_box(char* msg);
 void debug_message(char* msg);
 float engine_time();
 
+// strtod in the "C" locale, whatever locale the process has set.
+double parse_double(char* str, char** o_end);
+
+bool file_exists(char* path);
 char* load_file(char* path, size_t* size);
+
+// Reads up to buf_size bytes of a file into buf and returns how many were read.
+size_t read_file(char* path, void* buf, size_t buf_size);
+
+// Writes through a temporary file that replaces path when complete, so readers never see a partial file.
+bool write_file(char* path, void* data, size_t size);
+
+// Succeeds if the directory already exists.
+bool create_directory(char* path);
+
+// Maps a file copy-on-write: writes stay private to the mapping. Like load_file, the contents are followed by a '\0'.
+char* map_file(char* path, size_t* o_size);
+void unmap_file(char* data, size_t size);
+
+struct Thread;
+typedef void ThreadProc(void* arg);
+
+Thread* thread_start(ThreadProc* proc, void* arg);
+void thread_join(Thread* t);
+void thread_yield();
+int cpu_count();
+
+struct Semaphore;
+
+Semaphore* semaphore_create(int initial_count);
+void semaphore_free(Semaphore* s);
+void semaphore_signal(Semaphore* s, int count);
+void semaphore_wait(Semaphore* s);
@@ -0,0 +1,253 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+#include "common.h"
+
+static struct timespec time_start;
+static locale_t c_locale;
+
+void platform_init() {
+    clock_gettime(CLOCK_MONOTONIC, &time_start);
+    c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+void message_box(char* msg) {
+    fprintf(stderr, "%s\n", msg);
+}
+
+void debug_message(char* msg) {
+    fputs(msg, stderr);
+}
+
+double parse_double(char* str, char** o_end) {
+    return strtod_l(str, o_end, c_locale);
+}
+
+float engine_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = (double)(now.tv_sec - time_start.tv_sec) + (double)(now.tv_nsec - time_start.tv_nsec) * 1e-9;
+    return (float)time;
+}
+
+bool file_exists(char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+char* load_file(char* path, size_t* o_size) {
+    int fd = open(path, O_RDONLY);
+    assert(fd >= 0 && "File missing");
+
+    struct stat st;
+    fstat(fd, &st);
+
+    size_t s = (size_t)st.st_size;
+
+    char* buf = (char*)malloc(s + 1);
+    size_t total = 0;
+
+    while (total < s) {
+        ssize_t n = read(fd, buf + total, s - total);
+        if (n <= 0) {
+            break;
+        }
+
+        total += (size_t)n;
+    }
+
+    assert(total == s);
+    buf[total] = '\0';
+
+    close(fd);
+
+    if (o_size) {
+        *o_size = s;
+    }
+
+    return buf;
+}
+
+size_t read_file(char* path, void* buf, size_t buf_size) {
+    int fd = open(path, O_RDONLY);
+    assert(fd >= 0 && "File missing");
+
+    size_t total = 0;
+
+    while (total < buf_size) {
+        ssize_t n = read(fd, (char*)buf + total, buf_size - total);
+        if (n <= 0) {
+            break;
+        }
+
+        total += (size_t)n;
+    }
+
+    close(fd);
+
+    return total;
+}
+
+bool write_file(char* path, void* data, size_t size) {
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, (int)getpid());
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t total = 0;
+
+    while (total < size) {
+        ssize_t n = write(fd, (char*)data + total, size - total);
+        if (n <= 0) {
+            break;
+        }
+
+        total += (size_t)n;
+    }
+
+    bool ok = close(fd) == 0 && total == size && rename(temp_path, path) == 0;
+
+    if (!ok) {
+        unlink(temp_path);
+    }
+
+    return ok;
+}
+
+bool create_directory(char* path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static size_t mapping_size(size_t file_size) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return (file_size + 1 + page_size - 1) / page_size * page_size;
+}
+
+char* map_file(char* path, size_t* o_size) {
+    int fd = open(path, O_RDONLY);
+    assert(fd >= 0 && "File missing");
+
+    struct stat st;
+    fstat(fd, &st);
+
+    size_t s = (size_t)st.st_size;
+
+    // Reserve zeroed pages one byte past the end, then map the file over the front of them.
+    // Bytes past the end of the file in its last page read as zero, and so does the spare page, so the contents are always terminated.
+    char* data = (char*)mmap(NULL, mapping_size(s), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(data != MAP_FAILED && "File mapping failed");
+
+    if (s) {
+        void* view = mmap(data, s, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        assert(view == data && "File mapping failed");
+        UNUSED(view);
+    }
+
+    close(fd);
+
+    if (o_size) {
+        *o_size = s;
+    }
+
+    return data;
+}
+
+void unmap_file(char* data, size_t size) {
+    munmap(data, mapping_size(size));
+}
+
+struct Thread {
+    pthread_t handle;
+    ThreadProc* proc;
+    void* arg;
+};
+
+static void* thread_entry(void* param) {
+    Thread* t = (Thread*)param;
+    t->proc(t->arg);
+    return NULL;
+}
+
+Thread* thread_start(ThreadProc* proc, void* arg) {
+    Thread* t = (Thread*)calloc(1, sizeof(Thread));
+    t->proc = proc;
+    t->arg = arg;
+
+    int result = pthread_create(&t->handle, NULL, thread_entry, t);
+    assert(result == 0 && "Thread creation failed");
+    UNUSED(result);
+
+    return t;
+}
+
+void thread_join(Thread* t) {
+    pthread_join(t->handle, NULL);
+    free(t);
+}
+
+void thread_yield() {
+    sched_yield();
+}
+
+// Mutex and condition variable rather than sem_t, which macOS doesn't implement.
+struct Semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int count;
+};
+
+Semaphore* semaphore_create(int initial_count) {
+    Semaphore* s = (Semaphore*)calloc(1, sizeof(Semaphore));
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = initial_count;
+    return s;
+}
+
+void semaphore_free(Semaphore* s) {
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->mutex);
+    free(s);
+}
+
+void semaphore_signal(Semaphore* s, int count) {
+    pthread_mutex_lock(&s->mutex);
+    s->count += count;
+    pthread_mutex_unlock(&s->mutex);
+
+    if (count == 1) {
+        pthread_cond_signal(&s->cond);
+    }
+    else {
+        pthread_cond_broadcast(&s->cond);
+    }
+}
+
+void semaphore_wait(Semaphore* s) {
+    pthread_mutex_lock(&s->mutex);
+    while (s->count == 0) {
+        pthread_cond_wait(&s->cond, &s->mutex);
+    }
+    s->count--;
+    pthread_mutex_unlock(&s->mutex);
+}
+
+int cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
@@ -0,0 +1,247 @@
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+
+#include "common.h"
+
+static int64_t counter_start;
+static int64_t counter_freq;
+static _locale_t c_locale;
+
+void platform_init() {
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    counter_start = li.QuadPart;
+    QueryPerformanceFrequency(&li);
+    counter_freq = li.QuadPart;
+
+    c_locale = _create_locale(LC_ALL, "C");
+}
+
+double parse_double(char* str, char** o_end) {
+    return _strtod_l(str, o_end, c_locale);
+}
+
+void message_box(char* msg) {
+    MessageBoxA(NULL, msg, "Deez", 0);
+}
+
+void debug_message(char* msg) {
+    OutputDebugStringA(msg);
+}
+
+bool file_exists(char* path) {
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+char* load_file(char* path, size_t* o_size) {
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    assert(handle != INVALID_HANDLE_VALUE && "File missing");
+
+    LARGE_INTEGER li;
+    GetFileSizeEx(handle, &li);
+
+    size_t s = li.QuadPart;
+
+    char* buf = (char*)malloc(s + 1);
+    DWORD read = 0;
+    ReadFile(handle, buf, (DWORD)s, &read, NULL);
+    assert(read == s);
+    buf[read] = '\0';
+
+    CloseHandle(handle);
+
+    if (o_size) {
+        *o_size = s;
+    }
+
+    return buf;
+}
+
+size_t read_file(char* path, void* buf, size_t buf_size) {
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    assert(handle != INVALID_HANDLE_VALUE && "File missing");
+
+    size_t total = 0;
+
+    while (total < buf_size) {
+        size_t remaining = buf_size - total;
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+
+        DWORD read = 0;
+        if (!ReadFile(handle, (char*)buf + total, chunk, &read, NULL) || read == 0) {
+            break;
+        }
+
+        total += read;
+    }
+
+    CloseHandle(handle);
+
+    return total;
+}
+
+bool write_file(char* path, void* data, size_t size) {
+    char temp_path[MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.%lu.tmp", path, GetCurrentProcessId());
+
+    HANDLE handle = CreateFileA(temp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    size_t total = 0;
+
+    while (total < size) {
+        size_t remaining = size - total;
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+
+        DWORD written = 0;
+        if (!WriteFile(handle, (char*)data + total, chunk, &written, NULL) || written == 0) {
+            break;
+        }
+
+        total += written;
+    }
+
+    CloseHandle(handle);
+
+    if (total != size || !MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+bool create_directory(char* path) {
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+char* map_file(char* path, size_t* o_size) {
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    assert(handle != INVALID_HANDLE_VALUE && "File missing");
+
+    LARGE_INTEGER li;
+    GetFileSizeEx(handle, &li);
+
+    size_t s = li.QuadPart;
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    char* data = NULL;
+
+    // A view can't extend past the end of a read-only file, so the terminator comes from the zeroed tail
+    // of the last page. Files that end exactly on a page boundary are read into private pages instead.
+    if (s % info.dwPageSize != 0) {
+        HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        assert(mapping && "File mapping failed");
+
+        data = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        assert(data && "File mapping failed");
+
+        CloseHandle(mapping);
+    }
+    else {
+        data = (char*)VirtualAlloc(NULL, s + 1, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        assert(data);
+
+        DWORD read = 0;
+        ReadFile(handle, data, (DWORD)s, &read, NULL);
+        assert(read == s);
+    }
+
+    CloseHandle(handle);
+
+    if (o_size) {
+        *o_size = s;
+    }
+
+    return data;
+}
+
+void unmap_file(char* data, size_t size) {
+    UNUSED(size);
+
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(data, &info, sizeof(info));
+
+    if (info.Type == MEM_MAPPED) {
+        UnmapViewOfFile(data);
+    }
+    else {
+        VirtualFree(data, 0, MEM_RELEASE);
+    }
+}
+
+struct Thread {
+    HANDLE handle;
+    ThreadProc* proc;
+    void* arg;
+};
+
+static DWORD WINAPI thread_entry(LPVOID param) {
+    Thread* t = (Thread*)param;
+    t->proc(t->arg);
+    return 0;
+}
+
+Thread* thread_start(ThreadProc* proc, void* arg) {
+    Thread* t = (Thread*)calloc(1, sizeof(Thread));
+    t->proc = proc;
+    t->arg = arg;
+    t->handle = CreateThread(NULL, 0, thread_entry, t, 0, NULL);
+    assert(t->handle && "Thread creation failed");
+    return t;
+}
+
+void thread_join(Thread* t) {
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+    free(t);
+}
+
+void thread_yield() {
+    SwitchToThread();
+}
+
+struct Semaphore {
+    HANDLE handle;
+};
+
+Semaphore* semaphore_create(int initial_count) {
+    Semaphore* s = (Semaphore*)calloc(1, sizeof(Semaphore));
+    s->handle = CreateSemaphoreA(NULL, initial_count, LONG_MAX, NULL);
+    assert(s->handle && "Semaphore creation failed");
+    return s;
+}
+
+void semaphore_free(Semaphore* s) {
+    CloseHandle(s->handle);
+    free(s);
+}
+
+void semaphore_signal(Semaphore* s, int count) {
+    ReleaseSemaphore(s->handle, count, NULL);
+}
+
+void semaphore_wait(Semaphore* s) {
+    WaitForSingleObject(s->handle, INFINITE);
+}
+
+int cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+float engine_time() {
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    int64_t time_i = li.QuadPart - counter_start;
+    double time = (double)time_i / (double)counter_freq;
+    return (float)time;
+}
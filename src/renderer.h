@@ -1,21 +1,28 @@
 #pragma once
 
-#include <DirectXMath.h>
-using namespace DirectX;
-
 #include "common.h"
 
 struct Renderer;
 
+// Identifies a mesh added to a renderer. A zeroed handle is never valid.
+struct RDMesh {
+    uint32_t index;
+    uint32_t generation;
+};
+
 struct RDMeshVertex {
-    XMFLOAT3 pos;
-    XMFLOAT3 norm;
-    XMFLOAT2 uv;
+    Float3 pos;
+    Float3 norm;
+    Float2 uv;
 };
 
 Renderer* rd_init(void* window);
 void rd_free(Renderer* r);
 
-void rd_add_mesh(Renderer* r, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count);
+RDMesh rd_add_mesh(Renderer* r, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count);
+
+// Stops drawing the mesh at once. Its memory is freed when frames already submitted are done with it.
+// Stale handles are ignored.
+void rd_remove_mesh(Renderer* r, RDMesh mesh);
 
 void rd_render(Renderer* r);
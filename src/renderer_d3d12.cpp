@@ -1,12 +1,19 @@
 #include <dxgi1_4.h>
 #include <d3d12.h>
 #include <d3dcompiler.h>
+#include <DirectXMath.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
 
 #include "renderer.h"
+#include "mesh_pool.h"
+#include "descriptor_alloc.h"
+#include "buffer_heap.h"
+#include "upload_ring.h"
+
+using namespace DirectX;
 
 struct CommandList {
     uint64_t fence_val;
@@ -14,12 +21,20 @@ struct CommandList {
     ID3D12GraphicsCommandList* list;
 };
 
+// A copy from the upload ring into a heap block, queued until the next flush_uploads.
+struct UploadCopy {
+    uint32_t block;
+    uint64_t dst_offset;
+    uint64_t src_offset;
+    uint64_t size;
+};
+
+// Vertices and indices share one heap range, indices right after the vertices.
 struct Mesh {
-    ID3D12Resource* vbuffer;
-    ID3D12Resource* ibuffer;
+    BufferAlloc alloc;
+    D3D12_INDEX_BUFFER_VIEW ibv;
     uint32_t index_count;
-    int vbuffer_srv;
-    int ibuffer_srv;
+    uint32_t vbuffer_srv;
 };
 
 struct Renderer {
@@ -50,15 +65,24 @@ struct Renderer {
 
     ID3D12DescriptorHeap* binding_heap;
     size_t binding_view_stride;
-    int binding_heap_cap;
-    int binding_heap_alloc_count;
+    uint32_t binding_heap_cap;
+    DescriptorAllocator* binding_alloc;
+
+    MeshPool* meshes;
 
-    ID3D12Resource* camera_buffer;
-    int camera_cbvs[DXGI_MAX_SWAP_CHAIN_BUFFERS];
-    void* camera_buffer_ptrs[DXGI_MAX_SWAP_CHAIN_BUFFERS];
+    BufferHeap* buffer_heap;
+    ID3D12Resource** heap_blocks;
+    uint32_t heap_block_count;
 
-    int mesh_count;
-    Mesh meshes[1024];
+    // Transient data the GPU reads once: per-frame constants, and mesh data on its way into the heap blocks,
+    // which the CPU can't write. Space comes back as the submissions reading it complete.
+    ID3D12Resource* upload_buffer;
+    uint8_t* upload_ptr;
+    UploadRing* upload_ring;
+
+    UploadCopy* upload_copies;
+    uint32_t upload_copy_count;
+    uint32_t upload_copy_cap;
 
     ID3D12RootSignature* root_signature;
     ID3D12PipelineState* pipeline_state;
@@ -68,6 +92,10 @@ struct Renderer {
 
 #define ROUND_256(x) ((x + 255) & ~255)
 
+#define MESH_HEAP_BLOCK_SIZE (64 << 20)
+#define UPLOAD_RING_SIZE (32 << 20)
+#define UPLOAD_CHUNK_SIZE (UPLOAD_RING_SIZE / 4)
+
 static void hwnd_size(HWND hwnd, uint32_t* w, uint32_t* h) {
     assert(w != h);
 
@@ -145,7 +173,8 @@ static ID3D12RootSignature* create_root_signature(Renderer* r, D3D12_ROOT_SIGNAT
     return rs;
 }
 
-static ID3D12Resource* create_buffer(Renderer* r, size_t size) {
+// Upload heap buffers start readable by the GPU; default heap ones start common and are promoted on first use.
+static ID3D12Resource* create_buffer(Renderer* r, size_t size, D3D12_HEAP_TYPE heap_type) {
     D3D12_RESOURCE_DESC desc = {};
     desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
     desc.Width = size;
@@ -156,26 +185,41 @@ static ID3D12Resource* create_buffer(Renderer* r, size_t size) {
     desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 
     D3D12_HEAP_PROPERTIES heap_props = {};
-    heap_props.Type = D3D12_HEAP_TYPE_UPLOAD;
+    heap_props.Type = heap_type;
+
+    D3D12_RESOURCE_STATES state = heap_type == D3D12_HEAP_TYPE_UPLOAD ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON;
 
     ID3D12Resource* buffer = NULL;
-    r->device->CreateCommittedResource(&heap_props, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&buffer));
+    r->device->CreateCommittedResource(&heap_props, D3D12_HEAP_FLAG_NONE, &desc, state, NULL, IID_PPV_ARGS(&buffer));
 
     return buffer;
 }
 
-static int alloc_binding_view(Renderer* r) {
-    assert(r->binding_heap_alloc_count < r->binding_heap_cap);
-    return r->binding_heap_alloc_count++;
+static void create_heap_block(void* user, uint32_t block, uint32_t size) {
+    Renderer* r = (Renderer*)user;
+    assert(block == r->heap_block_count);
+    UNUSED(block);
+
+    r->heap_blocks = (ID3D12Resource**)realloc(r->heap_blocks, (r->heap_block_count + 1) * sizeof(ID3D12Resource*));
+    r->heap_blocks[r->heap_block_count++] = create_buffer(r, size, D3D12_HEAP_TYPE_DEFAULT);
 }
 
-static D3D12_CPU_DESCRIPTOR_HANDLE binding_view_handle_cpu(Renderer* r, int idx) {
-    assert(idx < r->binding_heap_alloc_count);
+static uint32_t alloc_binding_view(Renderer* r) {
+    uint32_t idx = descriptor_alloc(r->binding_alloc, 1);
+    if (idx == DESCRIPTOR_INVALID) {
+        message_box("Out of binding descriptors");
+        assert(false);
+    }
+    return idx;
+}
+
+static D3D12_CPU_DESCRIPTOR_HANDLE binding_view_handle_cpu(Renderer* r, uint32_t idx) {
+    assert(idx < r->binding_heap_cap);
     return  { r->binding_heap->GetCPUDescriptorHandleForHeapStart().ptr + idx * r->binding_view_stride };
 }
 
-static D3D12_GPU_DESCRIPTOR_HANDLE binding_view_handle_gpu(Renderer* r, int idx) {
-    assert(idx < r->binding_heap_alloc_count);
+static D3D12_GPU_DESCRIPTOR_HANDLE binding_view_handle_gpu(Renderer* r, uint32_t idx) {
+    assert(idx < r->binding_heap_cap);
     return  { r->binding_heap->GetGPUDescriptorHandleForHeapStart().ptr + idx * r->binding_view_stride };
 }
 
@@ -258,7 +302,7 @@ Renderer* rd_init(void* window) {
 
     r->device->CreateDescriptorHeap(&rtv_heap_desc, IID_PPV_ARGS(&r->rtv_heap));
 
-    r->binding_heap_cap = 1024;
+    r->binding_heap_cap = 1 << 18;
 
     D3D12_DESCRIPTOR_HEAP_DESC binding_heap_desc = {};
     binding_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
@@ -266,6 +310,7 @@ Renderer* rd_init(void* window) {
     binding_heap_desc.Flags |= D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
     r->device->CreateDescriptorHeap(&binding_heap_desc, IID_PPV_ARGS(&r->binding_heap));
+    r->binding_alloc = descriptor_allocator_create(r->binding_heap_cap);
 
     r->binding_view_stride = r->device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
@@ -277,49 +322,35 @@ Renderer* rd_init(void* window) {
 
     create_rtvs(r);
 
-    r->camera_buffer = create_buffer(r, ROUND_256(sizeof(XMMATRIX)) * DXGI_MAX_SWAP_CHAIN_BUFFERS);
-
-    void* camera_buffer_ptr;
-    r->camera_buffer->Map(0, NULL, &camera_buffer_ptr);
-
-    for (uint32_t i = 0; i < DXGI_MAX_SWAP_CHAIN_BUFFERS; ++i) {
-        r->camera_cbvs[i] = alloc_binding_view(r);
+    r->upload_buffer = create_buffer(r, UPLOAD_RING_SIZE, D3D12_HEAP_TYPE_UPLOAD);
+    r->upload_ring = upload_ring_create(UPLOAD_RING_SIZE);
 
-        uint64_t buffer_stride = ROUND_256(sizeof(XMMATRIX));
-        r->camera_buffer_ptrs[i] = (uint8_t*)camera_buffer_ptr + i * buffer_stride;
+    void* upload_ptr = NULL;
+    r->upload_buffer->Map(0, NULL, &upload_ptr);
+    r->upload_ptr = (uint8_t*)upload_ptr;
 
-        D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc = {};
-        cbv_desc.BufferLocation = r->camera_buffer->GetGPUVirtualAddress() + i * buffer_stride;
-        cbv_desc.SizeInBytes = (uint32_t)buffer_stride;
-
-        r->device->CreateConstantBufferView(&cbv_desc, binding_view_handle_cpu(r, r->camera_cbvs[i]));
-    }
+    r->meshes = mesh_pool_create(sizeof(Mesh));
+    r->buffer_heap = buffer_heap_create(MESH_HEAP_BLOCK_SIZE, create_heap_block, r);
 
     ID3DBlob* vs = compile_shader(L"test.hlsl", "vs_main", "vs_5_1");
     ID3DBlob* ps = compile_shader(L"test.hlsl", "ps_main", "ps_5_1");
 
-    D3D12_DESCRIPTOR_RANGE descriptor_ranges[3] = {};
+    D3D12_DESCRIPTOR_RANGE vbuffer_range = {};
+    vbuffer_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    vbuffer_range.NumDescriptors = 1;
+    vbuffer_range.BaseShaderRegister = 0;
 
-    descriptor_ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-    descriptor_ranges[0].NumDescriptors = 1;
-    descriptor_ranges[0].BaseShaderRegister = 0;
+    D3D12_ROOT_PARAMETER root_params[2] = {};
 
-    descriptor_ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    descriptor_ranges[1].NumDescriptors = 1;
-    descriptor_ranges[1].BaseShaderRegister = 0;
+    // The camera constants live in the upload ring at a new address each frame, so they are bound directly.
+    root_params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    root_params[0].Descriptor.ShaderRegister = 0;
+    root_params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 
-    descriptor_ranges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    descriptor_ranges[2].NumDescriptors = 1;
-    descriptor_ranges[2].BaseShaderRegister = 1;
-
-    D3D12_ROOT_PARAMETER root_params[ARR_LEN(descriptor_ranges)] = {};
-
-    for (int i = 0; i < ARR_LEN(descriptor_ranges); ++i) {
-        root_params[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        root_params[i].DescriptorTable.NumDescriptorRanges = 1;
-        root_params[i].DescriptorTable.pDescriptorRanges = descriptor_ranges + i;
-        root_params[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-    }
+    root_params[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_params[1].DescriptorTable.NumDescriptorRanges = 1;
+    root_params[1].DescriptorTable.pDescriptorRanges = &vbuffer_range;
+    root_params[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 
     D3D12_ROOT_SIGNATURE_DESC root_signature_desc = {};
     root_signature_desc.NumParameters = ARR_LEN(root_params);
@@ -406,6 +437,115 @@ static void update_cmd_lists(Renderer* r) {
     }
 }
 
+static CommandList* open_cmd_list(Renderer* r) {
+    if (r->free_cmdl_count == 0) {
+        update_cmd_lists(r);
+    }
+
+    if (r->free_cmdl_count == 0) {
+        assert(r->cmdl_count < DXGI_MAX_SWAP_CHAIN_BUFFERS);
+        debug_message("Creating a command list\n");
+
+        CommandList* cmdl = r->cmdls + r->cmdl_count++;
+
+        r->device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdl->allocator));
+        r->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdl->allocator, NULL, IID_PPV_ARGS(&cmdl->list));
+        cmdl->list->Close();
+
+        r->free_cmdls[r->free_cmdl_count++] = cmdl;
+    }
+
+    CommandList* cmdl = r->free_cmdls[--r->free_cmdl_count];
+
+    cmdl->allocator->Reset();
+    cmdl->list->Reset(cmdl->allocator, NULL);
+
+    return cmdl;
+}
+
+static uint64_t submit_cmd_list(Renderer* r, CommandList* cmdl) {
+    cmdl->list->Close();
+
+    ID3D12CommandList* submissions[] = { cmdl->list };
+    r->queue->ExecuteCommandLists(ARR_LEN(submissions), submissions);
+
+    cmdl->fence_val = fence_signal(r);
+    r->in_flight_cmdls[r->in_flight_cmdl_count++] = cmdl;
+
+    return cmdl->fence_val;
+}
+
+// Submitted on its own so the blocks decay back to the common state afterwards,
+// which lets later lists read them without barriers.
+static void flush_uploads(Renderer* r) {
+    if (r->upload_copy_count == 0) {
+        return;
+    }
+
+    CommandList* cmdl = open_cmd_list(r);
+
+    for (uint32_t i = 0; i < r->upload_copy_count; ++i) {
+        UploadCopy* c = r->upload_copies + i;
+        cmdl->list->CopyBufferRegion(r->heap_blocks[c->block], c->dst_offset, r->upload_buffer, c->src_offset, c->size);
+    }
+
+    r->upload_copy_count = 0;
+    upload_ring_submit(r->upload_ring, submit_cmd_list(r, cmdl));
+}
+
+// Returns an offset into the upload buffer, stalling until enough of the ring is free.
+static uint64_t alloc_upload(Renderer* r, uint64_t size, uint64_t alignment) {
+    uint64_t offset;
+
+    while ((offset = upload_ring_alloc(r->upload_ring, size, alignment)) == UPLOAD_RING_FULL) {
+        // Queued copies hold ring space too, so they go out before waiting.
+        flush_uploads(r);
+
+        uint64_t fence = upload_ring_oldest_fence(r->upload_ring);
+        assert(fence);
+
+        fence_sync(r, fence);
+        upload_ring_retire(r->upload_ring, r->fence->GetCompletedValue());
+    }
+
+    return offset;
+}
+
+// Copies data into the block through the upload ring, in pieces if it is large.
+// Copies that continue the previous one in both buffers are merged into it.
+static void stage_upload(Renderer* r, uint32_t block, uint64_t dst_offset, void* data, uint64_t size) {
+    uint8_t* src = (uint8_t*)data;
+
+    while (size > 0) {
+        uint64_t chunk = size < UPLOAD_CHUNK_SIZE ? size : UPLOAD_CHUNK_SIZE;
+        uint64_t src_offset = alloc_upload(r, chunk, 16);
+
+        memcpy(r->upload_ptr + src_offset, src, chunk);
+
+        UploadCopy* last = r->upload_copy_count > 0 ? r->upload_copies + r->upload_copy_count - 1 : NULL;
+
+        if (last && last->block == block && last->dst_offset + last->size == dst_offset && last->src_offset + last->size == src_offset) {
+            last->size += chunk;
+        }
+        else {
+            if (r->upload_copy_count == r->upload_copy_cap) {
+                r->upload_copy_cap = r->upload_copy_cap ? r->upload_copy_cap * 2 : 64;
+                r->upload_copies = (UploadCopy*)realloc(r->upload_copies, r->upload_copy_cap * sizeof(UploadCopy));
+            }
+
+            UploadCopy* c = r->upload_copies + r->upload_copy_count++;
+            c->block = block;
+            c->dst_offset = dst_offset;
+            c->src_offset = src_offset;
+            c->size = chunk;
+        }
+
+        src += chunk;
+        dst_offset += chunk;
+        size -= chunk;
+    }
+}
+
 static void release_swapchain_buffers(Renderer* r) {
     DXGI_SWAP_CHAIN_DESC1 swapchain_desc;
     r->swapchain->GetDesc1(&swapchain_desc);
@@ -415,6 +555,12 @@ static void release_swapchain_buffers(Renderer* r) {
     }
 }
 
+static void release_mesh(void* user, void* item) {
+    Renderer* r = (Renderer*)user;
+    Mesh* m = (Mesh*)item;
+    buffer_heap_release(r->buffer_heap, m->alloc);
+}
+
 void rd_free(Renderer* r) {
     device_flush(r);
 
@@ -431,14 +577,25 @@ void rd_free(Renderer* r) {
     r->pipeline_state->Release();
     r->root_signature->Release();
 
-    for (int i = 0; i < r->mesh_count; ++i) {
-        Mesh* m = r->meshes + i;
-        m->vbuffer->Release();
-        m->ibuffer->Release();
+    for (uint32_t i = 0; i < mesh_pool_count(r->meshes); ++i) {
+        release_mesh(r, mesh_pool_item(r->meshes, i));
+    }
+
+    mesh_pool_retire(r->meshes, r->fence_val, release_mesh, r);
+    mesh_pool_free(r->meshes);
+
+    for (uint32_t i = 0; i < r->heap_block_count; ++i) {
+        r->heap_blocks[i]->Release();
     }
 
-    r->camera_buffer->Release();
+    free(r->heap_blocks);
+    buffer_heap_free(r->buffer_heap);
 
+    r->upload_buffer->Release();
+    upload_ring_free(r->upload_ring);
+    free(r->upload_copies);
+
+    descriptor_allocator_free(r->binding_alloc);
     r->binding_heap->Release();
     r->rtv_heap->Release();
 
@@ -455,49 +612,54 @@ void rd_free(Renderer* r) {
     free(r);
 }
 
-void rd_add_mesh(Renderer* r, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
-    assert(r->mesh_count < ARR_LEN(r->meshes));
+RDMesh rd_add_mesh(Renderer* r, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    Mesh* slot = NULL;
+    RDMesh handle = mesh_pool_add(r->meshes, (void**)&slot);
 
-    size_t vertex_data_size = vertex_count * sizeof(RDMeshVertex);
-    size_t index_data_size = index_count * sizeof(uint32_t);
+    uint32_t vertex_data_size = vertex_count * sizeof(RDMeshVertex);
+    uint32_t index_data_size = index_count * sizeof(uint32_t);
 
     Mesh m;
 
-    m.vbuffer = create_buffer(r, vertex_data_size);
-    m.ibuffer = create_buffer(r, index_data_size);
-
-    void* vbuffer_ptr = NULL;
-    m.vbuffer->Map(0, NULL, &vbuffer_ptr);
-    memcpy(vbuffer_ptr, vertex_data, vertex_data_size);
-    m.vbuffer->Unmap(0, NULL);
+    // Aligned to the vertex size, so the SRV can start a whole number of vertices into the block.
+    m.alloc = buffer_heap_alloc(r->buffer_heap, vertex_data_size + index_data_size, sizeof(RDMeshVertex));
+    ID3D12Resource* block = r->heap_blocks[m.alloc.block];
 
-    void* ibuffer_ptr = NULL;
-    m.ibuffer->Map(0, NULL, &ibuffer_ptr);
-    memcpy(ibuffer_ptr, index_data, index_data_size);
-    m.ibuffer->Unmap(0, NULL);
+    stage_upload(r, m.alloc.block, m.alloc.offset, vertex_data, vertex_data_size);
+    stage_upload(r, m.alloc.block, m.alloc.offset + vertex_data_size, index_data, index_data_size);
 
     m.vbuffer_srv = alloc_binding_view(r);
-    m.ibuffer_srv = alloc_binding_view(r);
 
     D3D12_SHADER_RESOURCE_VIEW_DESC vbuffer_srv_desc = {};
     vbuffer_srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
     vbuffer_srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    vbuffer_srv_desc.Buffer.FirstElement = m.alloc.offset / sizeof(RDMeshVertex);
     vbuffer_srv_desc.Buffer.NumElements = vertex_count;
     vbuffer_srv_desc.Buffer.StructureByteStride = sizeof(RDMeshVertex);
 
-    r->device->CreateShaderResourceView(m.vbuffer, &vbuffer_srv_desc, binding_view_handle_cpu(r, m.vbuffer_srv));
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC ibuffer_srv_desc = {};
-    ibuffer_srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-    ibuffer_srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    ibuffer_srv_desc.Buffer.NumElements = index_count;
-    ibuffer_srv_desc.Buffer.StructureByteStride = sizeof(uint32_t);
+    r->device->CreateShaderResourceView(block, &vbuffer_srv_desc, binding_view_handle_cpu(r, m.vbuffer_srv));
 
-    r->device->CreateShaderResourceView(m.ibuffer, &ibuffer_srv_desc, binding_view_handle_cpu(r, m.ibuffer_srv));
+    // Indexed draws let the post-transform cache reuse vertices, which is what the import-time ordering targets.
+    m.ibv.BufferLocation = block->GetGPUVirtualAddress() + m.alloc.offset + vertex_data_size;
+    m.ibv.SizeInBytes = index_data_size;
+    m.ibv.Format = DXGI_FORMAT_R32_UINT;
 
     m.index_count = index_count;
 
-    r->meshes[r->mesh_count++] = m;
+    *slot = m;
+
+    return handle;
+}
+
+void rd_remove_mesh(Renderer* r, RDMesh mesh) {
+    Mesh* m = (Mesh*)mesh_pool_get(r->meshes, mesh);
+    if (!m) {
+        return;
+    }
+
+    // Frames submitted so far signal at most fence_val, so the slot and descriptor are free once that completes.
+    descriptor_free_deferred(r->binding_alloc, m->vbuffer_srv, r->fence_val);
+    mesh_pool_remove(r->meshes, mesh, r->fence_val);
 }
 
 void rd_render(Renderer* r) {
@@ -529,23 +691,14 @@ void rd_render(Renderer* r) {
 
     update_cmd_lists(r);
 
-    if (r->free_cmdl_count == 0) {
-        assert(r->cmdl_count < DXGI_MAX_SWAP_CHAIN_BUFFERS);
-        debug_message("Creating a command list\n");
+    uint64_t completed_fence = r->fence->GetCompletedValue();
+    mesh_pool_retire(r->meshes, completed_fence, release_mesh, r);
+    descriptor_retire(r->binding_alloc, completed_fence);
+    upload_ring_retire(r->upload_ring, completed_fence);
 
-        CommandList* cmdl = r->cmdls + r->cmdl_count++;
+    flush_uploads(r);
 
-        r->device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdl->allocator));
-        r->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdl->allocator, NULL, IID_PPV_ARGS(&cmdl->list));
-        cmdl->list->Close();
-
-        r->free_cmdls[r->free_cmdl_count++] = cmdl;
-    }
-
-    CommandList* cmdl = r->free_cmdls[--r->free_cmdl_count];
-
-    cmdl->allocator->Reset();
-    cmdl->list->Reset(cmdl->allocator, NULL);
+    CommandList* cmdl = open_cmd_list(r);
 
     cmdl->list->SetDescriptorHeaps(1, &r->binding_heap);
 
@@ -579,27 +732,23 @@ void rd_render(Renderer* r) {
 
     XMMATRIX camera_transform = XMMatrixTranslation(sinf(engine_time() * PI_32), 0.0f, 3.0f);
     XMMATRIX camera_matrix = XMMatrixRotationRollPitchYaw(0.0f, 0.0f, sinf(cosf(engine_time()) * 2.0f) * 3.149f) * XMMatrixInverse(NULL, camera_transform) * XMMatrixPerspectiveFovRH(3.14159f * 0.25f, (float)window_width / (float)window_height, 0.1f, 1000.0f);
-    memcpy(r->camera_buffer_ptrs[swapchain_index], &camera_matrix, sizeof(camera_matrix));
-    cmdl->list->SetGraphicsRootDescriptorTable(0, binding_view_handle_gpu(r, r->camera_cbvs[swapchain_index]));
 
-    for (int i = 0; i < r->mesh_count; ++i) {
-        Mesh* m = r->meshes + i;
+    uint64_t camera_offset = alloc_upload(r, ROUND_256(sizeof(XMMATRIX)), 256);
+    memcpy(r->upload_ptr + camera_offset, &camera_matrix, sizeof(camera_matrix));
+    cmdl->list->SetGraphicsRootConstantBufferView(0, r->upload_buffer->GetGPUVirtualAddress() + camera_offset);
+
+    for (uint32_t i = 0; i < mesh_pool_count(r->meshes); ++i) {
+        Mesh* m = (Mesh*)mesh_pool_item(r->meshes, i);
         cmdl->list->SetGraphicsRootDescriptorTable(1, binding_view_handle_gpu(r, m->vbuffer_srv));
-        cmdl->list->SetGraphicsRootDescriptorTable(2, binding_view_handle_gpu(r, m->ibuffer_srv));
-        cmdl->list->DrawInstanced(m->index_count, 1, 0, 0);
+        cmdl->list->IASetIndexBuffer(&m->ibv);
+        cmdl->list->DrawIndexedInstanced(m->index_count, 1, 0, 0, 0);
     }
 
     barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
     barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
     cmdl->list->ResourceBarrier(1, &barrier);
 
-    cmdl->list->Close();
-
-    ID3D12CommandList* submissions[] = { cmdl->list };
-    r->queue->ExecuteCommandLists(ARR_LEN(submissions), submissions);
-
-    cmdl->fence_val = fence_signal(r);
-    r->in_flight_cmdls[r->in_flight_cmdl_count++] = cmdl;
+    upload_ring_submit(r->upload_ring, submit_cmd_list(r, cmdl));
     cmdl = NULL;
    
     r->swapchain->Present(0, 0);
@@ -0,0 +1,826 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <emmintrin.h>
+
+#include "renderer_soft.h"
+#include "mesh_pool.h"
+
+// Screen-space positions are 28.4 fixed point. Triangles are clipped to a guard band of this many pixels
+// around the screen centre, which keeps edge functions inside a tile within 32 bits.
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_SIZE (1 << SUBPIXEL_BITS)
+#define GUARD_BAND_PIXELS 7680.0f
+
+#define TILE_SIZE 64
+
+#define TRANSFORM_CHUNK_VERTICES 4096
+#define BIN_BATCH_TRIANGLES 512
+
+// Matches the clear colour of the D3D12 backend, 0.01 in RGBA8_UNORM.
+#define CLEAR_COLOR 0xFF030303
+
+struct Mat4 {
+    float m[4][4];
+};
+
+struct SoftMesh {
+    uint32_t vertex_count;
+    uint32_t index_count;
+
+    // Structure of arrays, padded to a multiple of four so the transform never needs a scalar tail.
+    float* pos[3];
+    float* clip[4];
+    Float3* norms;
+    uint32_t* indices;
+};
+
+// A triangle after clipping and setup. Attributes are planes in pixel space: value at vertex 0, then d/dx and d/dy.
+struct SoftTri {
+    int32_t x[3];
+    int32_t y[3];
+    int32_t min_x, min_y, max_x, max_y;
+    float origin_x, origin_y;
+    float planes[5][3]; // z/w, 1/w, then the normal over w.
+};
+
+struct TransformChunk {
+    SoftMesh* mesh;
+    uint32_t begin;
+    uint32_t end;
+};
+
+struct BinBatch {
+    SoftMesh* mesh;
+    uint32_t tri_begin;
+    uint32_t tri_end;
+
+    SoftTri* tris;
+    uint32_t tri_count;
+    uint32_t tri_cap;
+};
+
+struct Renderer {
+    JobSystem* js;
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint32_t* color;
+    float* depth;
+
+    uint32_t tiles_x;
+    uint32_t tile_count;
+
+    bool fixed_time;
+    float time;
+    Mat4 camera;
+
+    MeshPool* meshes;
+
+    // Work lists over the live meshes, rebuilt by the next rd_render after meshes are added or removed.
+    bool work_dirty;
+
+    TransformChunk* chunks;
+    uint32_t chunk_count;
+    uint32_t chunk_cap;
+
+    BinBatch* batches;
+    uint32_t batch_count;
+    uint32_t batch_cap;
+
+    // Triangles each batch put in each tile, batch-major. The prefix sum turns these into write cursors.
+    uint32_t* tile_counts;
+    uint32_t tile_counts_cap;
+
+    // Tile t's triangles are tile_refs[tile_starts[t]..tile_starts[t + 1]), in submission order.
+    uint32_t* tile_starts;
+    SoftTri** tile_refs;
+    uint32_t tile_refs_cap;
+
+    RDSoftStats stats;
+};
+
+static Mat4 mat4_mul(Mat4 a, Mat4 b) {
+    Mat4 r = {};
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+        }
+    }
+    return r;
+}
+
+// Same animated camera as the D3D12 backend, with DirectXMath's row-vector conventions.
+static Mat4 camera_matrix(float time, float aspect) {
+    float roll = sinf(cosf(time) * 2.0f) * 3.149f;
+
+    Mat4 rotation = {};
+    rotation.m[0][0] = cosf(roll);
+    rotation.m[0][1] = sinf(roll);
+    rotation.m[1][0] = -sinf(roll);
+    rotation.m[1][1] = cosf(roll);
+    rotation.m[2][2] = 1.0f;
+    rotation.m[3][3] = 1.0f;
+
+    Mat4 view = {};
+    view.m[0][0] = 1.0f;
+    view.m[1][1] = 1.0f;
+    view.m[2][2] = 1.0f;
+    view.m[3][0] = -sinf(time * PI_32);
+    view.m[3][1] = 0.0f;
+    view.m[3][2] = -3.0f;
+    view.m[3][3] = 1.0f;
+
+    float near_z = 0.1f;
+    float far_z = 1000.0f;
+    float h = 1.0f / tanf(3.14159f * 0.25f * 0.5f);
+    float range = far_z / (near_z - far_z);
+
+    Mat4 proj = {};
+    proj.m[0][0] = h / aspect;
+    proj.m[1][1] = h;
+    proj.m[2][2] = range;
+    proj.m[2][3] = -1.0f;
+    proj.m[3][2] = range * near_z;
+
+    return mat4_mul(mat4_mul(rotation, view), proj);
+}
+
+Renderer* rd_init(void* window) {
+    RDSoftDesc* desc = (RDSoftDesc*)window;
+    assert(desc->width > 0 && desc->height > 0 && desc->js);
+
+    Renderer* r = (Renderer*)calloc(1, sizeof(Renderer));
+    r->js = desc->js;
+
+    // Storage covers whole tiles, so tiles never need edge cases.
+    r->width = desc->width;
+    r->height = desc->height;
+    r->tiles_x = (desc->width + TILE_SIZE - 1) / TILE_SIZE;
+    r->tile_count = r->tiles_x * ((desc->height + TILE_SIZE - 1) / TILE_SIZE);
+    r->pitch = r->tiles_x * TILE_SIZE;
+
+    size_t pixel_count = (size_t)r->pitch * (r->tile_count / r->tiles_x) * TILE_SIZE;
+    r->color = (uint32_t*)malloc(pixel_count * sizeof(uint32_t));
+    r->depth = (float*)malloc(pixel_count * sizeof(float));
+
+    r->tile_starts = (uint32_t*)calloc(r->tile_count + 1, sizeof(uint32_t));
+
+    r->meshes = mesh_pool_create(sizeof(SoftMesh));
+
+    return r;
+}
+
+static void release_mesh(void* user, void* item) {
+    UNUSED(user);
+
+    SoftMesh* m = (SoftMesh*)item;
+    for (int c = 0; c < 3; ++c) {
+        free(m->pos[c]);
+    }
+    for (int c = 0; c < 4; ++c) {
+        free(m->clip[c]);
+    }
+    free(m->norms);
+    free(m->indices);
+}
+
+void rd_free(Renderer* r) {
+    for (uint32_t i = 0; i < mesh_pool_count(r->meshes); ++i) {
+        release_mesh(NULL, mesh_pool_item(r->meshes, i));
+    }
+
+    mesh_pool_free(r->meshes);
+
+    for (uint32_t i = 0; i < r->batch_cap; ++i) {
+        free(r->batches[i].tris);
+    }
+
+    free(r->chunks);
+    free(r->batches);
+    free(r->tile_counts);
+    free(r->tile_starts);
+    free(r->tile_refs);
+    free(r->color);
+    free(r->depth);
+    free(r);
+}
+
+RDMesh rd_add_mesh(Renderer* r, RDMeshVertex* vertex_data, uint32_t vertex_count, uint32_t* index_data, uint32_t index_count) {
+    SoftMesh* m = NULL;
+    RDMesh handle = mesh_pool_add(r->meshes, (void**)&m);
+
+    uint32_t padded_count = (vertex_count + 3) & ~3u;
+
+    m->vertex_count = vertex_count;
+    m->index_count = index_count - index_count % 3;
+
+    for (int c = 0; c < 3; ++c) {
+        m->pos[c] = (float*)calloc(padded_count, sizeof(float));
+    }
+    for (int c = 0; c < 4; ++c) {
+        m->clip[c] = (float*)malloc(padded_count * sizeof(float));
+    }
+
+    m->norms = (Float3*)malloc(vertex_count * sizeof(Float3));
+    m->indices = (uint32_t*)malloc(m->index_count * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+        m->pos[0][i] = vertex_data[i].pos.x;
+        m->pos[1][i] = vertex_data[i].pos.y;
+        m->pos[2][i] = vertex_data[i].pos.z;
+        m->norms[i] = vertex_data[i].norm;
+    }
+
+    for (uint32_t i = 0; i < m->index_count; ++i) {
+        assert(index_data[i] < vertex_count);
+        m->indices[i] = index_data[i];
+    }
+
+    r->work_dirty = true;
+
+    return handle;
+}
+
+void rd_remove_mesh(Renderer* r, RDMesh mesh) {
+    // Rendering finishes inside rd_render, so nothing is ever in flight here.
+    if (mesh_pool_remove(r->meshes, mesh, 0)) {
+        mesh_pool_retire(r->meshes, 0, release_mesh, NULL);
+        r->work_dirty = true;
+    }
+}
+
+// Splits the live meshes into transform chunks and binning batches. Batches keep their triangle storage across rebuilds.
+static void build_work(Renderer* r) {
+    r->chunk_count = 0;
+    r->batch_count = 0;
+    r->stats.triangle_count = 0;
+
+    for (uint32_t m = 0; m < mesh_pool_count(r->meshes); ++m) {
+        SoftMesh* mesh = (SoftMesh*)mesh_pool_item(r->meshes, m);
+
+        uint32_t padded_count = (mesh->vertex_count + 3) & ~3u;
+
+        for (uint32_t begin = 0; begin < padded_count; begin += TRANSFORM_CHUNK_VERTICES) {
+            if (r->chunk_count == r->chunk_cap) {
+                r->chunk_cap = r->chunk_cap ? r->chunk_cap * 2 : 64;
+                r->chunks = (TransformChunk*)realloc(r->chunks, r->chunk_cap * sizeof(TransformChunk));
+            }
+
+            TransformChunk* chunk = r->chunks + r->chunk_count++;
+            chunk->mesh = mesh;
+            chunk->begin = begin;
+            chunk->end = begin + TRANSFORM_CHUNK_VERTICES < padded_count ? begin + TRANSFORM_CHUNK_VERTICES : padded_count;
+        }
+
+        uint32_t tri_count = mesh->index_count / 3;
+
+        for (uint32_t begin = 0; begin < tri_count; begin += BIN_BATCH_TRIANGLES) {
+            if (r->batch_count == r->batch_cap) {
+                uint32_t old_cap = r->batch_cap;
+                r->batch_cap = r->batch_cap ? r->batch_cap * 2 : 64;
+                r->batches = (BinBatch*)realloc(r->batches, r->batch_cap * sizeof(BinBatch));
+                memset(r->batches + old_cap, 0, (r->batch_cap - old_cap) * sizeof(BinBatch));
+            }
+
+            BinBatch* batch = r->batches + r->batch_count++;
+            batch->mesh = mesh;
+            batch->tri_begin = begin;
+            batch->tri_end = begin + BIN_BATCH_TRIANGLES < tri_count ? begin + BIN_BATCH_TRIANGLES : tri_count;
+        }
+
+        r->stats.triangle_count += tri_count;
+    }
+
+    r->work_dirty = false;
+}
+
+static void transform_chunks(void* arg, uint32_t begin, uint32_t end) {
+    Renderer* r = (Renderer*)arg;
+
+    __m128 m[4][4];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            m[i][j] = _mm_set1_ps(r->camera.m[i][j]);
+        }
+    }
+
+    for (uint32_t c = begin; c < end; ++c) {
+        TransformChunk* chunk = r->chunks + c;
+        SoftMesh* mesh = chunk->mesh;
+
+        // Four vertices at a time: clip = pos.x * row0 + pos.y * row1 + pos.z * row2 + row3.
+        for (uint32_t i = chunk->begin; i < chunk->end; i += 4) {
+            __m128 x = _mm_loadu_ps(mesh->pos[0] + i);
+            __m128 y = _mm_loadu_ps(mesh->pos[1] + i);
+            __m128 z = _mm_loadu_ps(mesh->pos[2] + i);
+
+            for (int j = 0; j < 4; ++j) {
+                __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m[0][j]), _mm_mul_ps(y, m[1][j])), _mm_add_ps(_mm_mul_ps(z, m[2][j]), m[3][j]));
+                _mm_storeu_ps(mesh->clip[j] + i, v);
+            }
+        }
+    }
+}
+
+struct ClipVertex {
+    float x, y, z, w;
+    Float3 norm;
+};
+
+// Planes as coefficients of (x, y, z, w): near, far, then the four guard band sides.
+// The guard band coefficient is filled in per frame, since it depends on the resolution.
+#define CLIP_PLANE_COUNT 6
+#define MAX_CLIP_VERTICES (3 + CLIP_PLANE_COUNT)
+
+static float plane_distance(float* plane, ClipVertex* v) {
+    return plane[0] * v->x + plane[1] * v->y + plane[2] * v->z + plane[3] * v->w;
+}
+
+static int clip_polygon(ClipVertex* in, int count, ClipVertex* out, float* plane) {
+    int out_count = 0;
+
+    for (int i = 0; i < count; ++i) {
+        ClipVertex* a = in + i;
+        ClipVertex* b = in + (i + 1) % count;
+
+        float da = plane_distance(plane, a);
+        float db = plane_distance(plane, b);
+
+        if (da >= 0.0f) {
+            out[out_count++] = *a;
+        }
+
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float t = da / (da - db);
+
+            ClipVertex* v = out + out_count++;
+            v->x = a->x + (b->x - a->x) * t;
+            v->y = a->y + (b->y - a->y) * t;
+            v->z = a->z + (b->z - a->z) * t;
+            v->w = a->w + (b->w - a->w) * t;
+            v->norm.x = a->norm.x + (b->norm.x - a->norm.x) * t;
+            v->norm.y = a->norm.y + (b->norm.y - a->norm.y) * t;
+            v->norm.z = a->norm.z + (b->norm.z - a->norm.z) * t;
+        }
+    }
+
+    return out_count;
+}
+
+static void push_tri(BinBatch* batch, SoftTri* tri) {
+    if (batch->tri_count == batch->tri_cap) {
+        batch->tri_cap = batch->tri_cap ? batch->tri_cap * 2 : BIN_BATCH_TRIANGLES;
+        batch->tris = (SoftTri*)realloc(batch->tris, batch->tri_cap * sizeof(SoftTri));
+    }
+    batch->tris[batch->tri_count++] = *tri;
+}
+
+static void setup_tri(Renderer* r, BinBatch* batch, ClipVertex* v0, ClipVertex* v1, ClipVertex* v2) {
+    ClipVertex* v[3] = { v0, v1, v2 };
+
+    float inv_w[3];
+    int32_t fx[3];
+    int32_t fy[3];
+
+    for (int k = 0; k < 3; ++k) {
+        inv_w[k] = 1.0f / v[k]->w;
+        float sx = (v[k]->x * inv_w[k] * 0.5f + 0.5f) * (float)r->width;
+        float sy = (0.5f - v[k]->y * inv_w[k] * 0.5f) * (float)r->height;
+        fx[k] = (int32_t)floorf(sx * SUBPIXEL_SIZE + 0.5f);
+        fy[k] = (int32_t)floorf(sy * SUBPIXEL_SIZE + 0.5f);
+    }
+
+    // Counter-clockwise triangles face the camera, which with y pointing down gives a negative area.
+    // Back faces and degenerates are culled, and front faces are flipped so inside is positive for every edge.
+    int64_t area = (int64_t)(fx[1] - fx[0]) * (fy[2] - fy[0]) - (int64_t)(fx[2] - fx[0]) * (fy[1] - fy[0]);
+    if (area >= 0) {
+        return;
+    }
+
+    int order[3] = { 0, 2, 1 };
+
+    SoftTri tri;
+    tri.min_x = INT32_MAX;
+    tri.min_y = INT32_MAX;
+    tri.max_x = INT32_MIN;
+    tri.max_y = INT32_MIN;
+
+    float attrs[3][5];
+    float px[3];
+    float py[3];
+
+    for (int k = 0; k < 3; ++k) {
+        int s = order[k];
+        tri.x[k] = fx[s];
+        tri.y[k] = fy[s];
+
+        tri.min_x = fx[s] < tri.min_x ? fx[s] : tri.min_x;
+        tri.min_y = fy[s] < tri.min_y ? fy[s] : tri.min_y;
+        tri.max_x = fx[s] > tri.max_x ? fx[s] : tri.max_x;
+        tri.max_y = fy[s] > tri.max_y ? fy[s] : tri.max_y;
+
+        px[k] = (float)fx[s] / SUBPIXEL_SIZE;
+        py[k] = (float)fy[s] / SUBPIXEL_SIZE;
+
+        attrs[k][0] = v[s]->z * inv_w[s];
+        attrs[k][1] = inv_w[s];
+        attrs[k][2] = v[s]->norm.x * inv_w[s];
+        attrs[k][3] = v[s]->norm.y * inv_w[s];
+        attrs[k][4] = v[s]->norm.z * inv_w[s];
+    }
+
+    // Pixels whose centres could be inside, clamped to the screen.
+    tri.min_x = tri.min_x >> SUBPIXEL_BITS;
+    tri.min_y = tri.min_y >> SUBPIXEL_BITS;
+    tri.max_x = tri.max_x >> SUBPIXEL_BITS;
+    tri.max_y = tri.max_y >> SUBPIXEL_BITS;
+
+    tri.min_x = tri.min_x < 0 ? 0 : tri.min_x;
+    tri.min_y = tri.min_y < 0 ? 0 : tri.min_y;
+    tri.max_x = tri.max_x >= (int32_t)r->width ? (int32_t)r->width - 1 : tri.max_x;
+    tri.max_y = tri.max_y >= (int32_t)r->height ? (int32_t)r->height - 1 : tri.max_y;
+
+    if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) {
+        return;
+    }
+
+    tri.origin_x = px[0];
+    tri.origin_y = py[0];
+
+    float inv_area = 1.0f / ((px[1] - px[0]) * (py[2] - py[0]) - (px[2] - px[0]) * (py[1] - py[0]));
+
+    for (int a = 0; a < 5; ++a) {
+        float d1 = attrs[1][a] - attrs[0][a];
+        float d2 = attrs[2][a] - attrs[0][a];
+
+        tri.planes[a][0] = attrs[0][a];
+        tri.planes[a][1] = (d1 * (py[2] - py[0]) - d2 * (py[1] - py[0])) * inv_area;
+        tri.planes[a][2] = (d2 * (px[1] - px[0]) - d1 * (px[2] - px[0])) * inv_area;
+    }
+
+    push_tri(batch, &tri);
+}
+
+static void tile_range(SoftTri* tri, uint32_t* tx0, uint32_t* ty0, uint32_t* tx1, uint32_t* ty1) {
+    *tx0 = (uint32_t)tri->min_x / TILE_SIZE;
+    *ty0 = (uint32_t)tri->min_y / TILE_SIZE;
+    *tx1 = (uint32_t)tri->max_x / TILE_SIZE;
+    *ty1 = (uint32_t)tri->max_y / TILE_SIZE;
+}
+
+// Culls, clips and sets up each batch's triangles, counting how many land in each tile.
+static void setup_batches(void* arg, uint32_t begin, uint32_t end) {
+    Renderer* r = (Renderer*)arg;
+
+    float guard_x = GUARD_BAND_PIXELS / ((float)r->width * 0.5f);
+    float guard_y = GUARD_BAND_PIXELS / ((float)r->height * 0.5f);
+
+    float planes[CLIP_PLANE_COUNT][4] = {
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, -1.0f, 1.0f },
+        { 1.0f, 0.0f, 0.0f, guard_x },
+        { -1.0f, 0.0f, 0.0f, guard_x },
+        { 0.0f, 1.0f, 0.0f, guard_y },
+        { 0.0f, -1.0f, 0.0f, guard_y },
+    };
+
+    for (uint32_t b = begin; b < end; ++b) {
+        BinBatch* batch = r->batches + b;
+        SoftMesh* mesh = batch->mesh;
+
+        batch->tri_count = 0;
+
+        for (uint32_t t = batch->tri_begin; t < batch->tri_end; ++t) {
+            ClipVertex verts[3];
+            uint32_t outside_all = 0x3F;
+            uint32_t outside_any = 0;
+            uint32_t clip_any = 0;
+
+            for (int k = 0; k < 3; ++k) {
+                uint32_t idx = mesh->indices[t * 3 + k];
+                ClipVertex* v = verts + k;
+
+                v->x = mesh->clip[0][idx];
+                v->y = mesh->clip[1][idx];
+                v->z = mesh->clip[2][idx];
+                v->w = mesh->clip[3][idx];
+                v->norm = mesh->norms[idx];
+
+                // Outside the view volume, for trivial rejection.
+                uint32_t outside = 0;
+                outside |= (v->z < 0.0f) << 0;
+                outside |= (v->z > v->w) << 1;
+                outside |= (v->x < -v->w) << 2;
+                outside |= (v->x > v->w) << 3;
+                outside |= (v->y < -v->w) << 4;
+                outside |= (v->y > v->w) << 5;
+
+                outside_all &= outside;
+                outside_any |= outside;
+
+                for (int p = 0; p < CLIP_PLANE_COUNT; ++p) {
+                    clip_any |= (plane_distance(planes[p], v) < 0.0f) << p;
+                }
+            }
+
+            if (outside_all) {
+                continue;
+            }
+
+            if (!clip_any) {
+                setup_tri(r, batch, verts + 0, verts + 1, verts + 2);
+                continue;
+            }
+
+            ClipVertex poly[2][MAX_CLIP_VERTICES];
+            memcpy(poly[0], verts, sizeof(verts));
+
+            int count = 3;
+            int cur = 0;
+
+            for (int p = 0; p < CLIP_PLANE_COUNT && count >= 3; ++p) {
+                if (clip_any & (1 << p)) {
+                    count = clip_polygon(poly[cur], count, poly[cur ^ 1], planes[p]);
+                    cur ^= 1;
+                }
+            }
+
+            for (int k = 1; k + 1 < count; ++k) {
+                setup_tri(r, batch, poly[cur] + 0, poly[cur] + k, poly[cur] + k + 1);
+            }
+        }
+
+        uint32_t* counts = r->tile_counts + b * r->tile_count;
+        memset(counts, 0, r->tile_count * sizeof(uint32_t));
+
+        for (uint32_t i = 0; i < batch->tri_count; ++i) {
+            uint32_t tx0, ty0, tx1, ty1;
+            tile_range(batch->tris + i, &tx0, &ty0, &tx1, &ty1);
+
+            for (uint32_t ty = ty0; ty <= ty1; ++ty) {
+                for (uint32_t tx = tx0; tx <= tx1; ++tx) {
+                    counts[ty * r->tiles_x + tx]++;
+                }
+            }
+        }
+    }
+}
+
+// Writes each batch's triangles into the tile lists, at cursors the prefix sum left in tile_counts.
+static void bin_batches(void* arg, uint32_t begin, uint32_t end) {
+    Renderer* r = (Renderer*)arg;
+
+    for (uint32_t b = begin; b < end; ++b) {
+        BinBatch* batch = r->batches + b;
+        uint32_t* cursors = r->tile_counts + b * r->tile_count;
+
+        for (uint32_t i = 0; i < batch->tri_count; ++i) {
+            uint32_t tx0, ty0, tx1, ty1;
+            tile_range(batch->tris + i, &tx0, &ty0, &tx1, &ty1);
+
+            for (uint32_t ty = ty0; ty <= ty1; ++ty) {
+                for (uint32_t tx = tx0; tx <= tx1; ++tx) {
+                    r->tile_refs[cursors[ty * r->tiles_x + tx]++] = batch->tris + i;
+                }
+            }
+        }
+    }
+}
+
+struct EdgeSetup {
+    int32_t start;
+    int32_t step_x;
+    int32_t step_y;
+};
+
+// Rasterizes one triangle over the pixels [x0, x1] x [y0, y1] of a tile, four pixels at a time.
+static void raster_tri(Renderer* r, SoftTri* tri, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    int32_t group_x1 = (x1 & ~3) + 3;
+
+    EdgeSetup edges[3];
+    int edge_count = 0;
+
+    for (int e = 0; e < 3; ++e) {
+        int a = e;
+        int b = e == 2 ? 0 : e + 1;
+
+        int64_t A = (int64_t)tri->y[a] - tri->y[b];
+        int64_t B = (int64_t)tri->x[b] - tri->x[a];
+
+        // Top-left rule: pixels exactly on an edge belong to the triangle only for top and left edges.
+        int64_t bias = (A > 0 || (A == 0 && B > 0)) ? 0 : 1;
+
+        int64_t E = A * ((int64_t)x0 * SUBPIXEL_SIZE + SUBPIXEL_SIZE / 2 - tri->x[a]) +
+                    B * ((int64_t)y0 * SUBPIXEL_SIZE + SUBPIXEL_SIZE / 2 - tri->y[a]) - bias;
+
+        int64_t dx = A * SUBPIXEL_SIZE * (group_x1 - x0);
+        int64_t dy = B * SUBPIXEL_SIZE * (y1 - y0);
+
+        int64_t lo = E + (dx < 0 ? dx : 0) + (dy < 0 ? dy : 0);
+        int64_t hi = E + (dx > 0 ? dx : 0) + (dy > 0 ? dy : 0);
+
+        if (hi < 0) {
+            return;
+        }
+
+        // Edges that pass the whole region are skipped. The rest cross it, which bounds them to 32 bits.
+        if (lo < 0) {
+            edges[edge_count].start = (int32_t)E;
+            edges[edge_count].step_x = (int32_t)(A * SUBPIXEL_SIZE);
+            edges[edge_count].step_y = (int32_t)(B * SUBPIXEL_SIZE);
+            edge_count++;
+        }
+    }
+
+    float dx0 = (float)x0 + 0.5f - tri->origin_x;
+    float dy0 = (float)y0 + 0.5f - tri->origin_y;
+
+    __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+    __m128 plane_dx[5];
+    __m128 plane_step[5];
+    for (int a = 0; a < 5; ++a) {
+        plane_dx[a] = _mm_mul_ps(lanes, _mm_set1_ps(tri->planes[a][1]));
+        plane_step[a] = _mm_set1_ps(tri->planes[a][1] * 4.0f);
+    }
+
+    __m128i edge_dx[3];
+    __m128i edge_step[3];
+    for (int e = 0; e < edge_count; ++e) {
+        edge_dx[e] = _mm_set_epi32(edges[e].step_x * 3, edges[e].step_x * 2, edges[e].step_x, 0);
+        edge_step[e] = _mm_set1_epi32(edges[e].step_x * 4);
+    }
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 scale = _mm_set1_ps(255.0f);
+    __m128 round = _mm_set1_ps(0.5f);
+    __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+    for (int32_t y = y0; y <= y1; ++y) {
+        int32_t row = y - y0;
+        float fy = dy0 + (float)row;
+
+        __m128i ev[3];
+        for (int e = 0; e < edge_count; ++e) {
+            ev[e] = _mm_add_epi32(_mm_set1_epi32(edges[e].start + edges[e].step_y * row), edge_dx[e]);
+        }
+
+        __m128 pv[5];
+        for (int a = 0; a < 5; ++a) {
+            float v = tri->planes[a][0] + tri->planes[a][1] * dx0 + tri->planes[a][2] * fy;
+            pv[a] = _mm_add_ps(_mm_set1_ps(v), plane_dx[a]);
+        }
+
+        uint32_t* color_row = r->color + (size_t)y * r->pitch;
+        float* depth_row = r->depth + (size_t)y * r->pitch;
+
+        for (int32_t x = x0; x <= x1; x += 4) {
+            __m128i outside = _mm_setzero_si128();
+            for (int e = 0; e < edge_count; ++e) {
+                outside = _mm_or_si128(outside, ev[e]);
+                ev[e] = _mm_add_epi32(ev[e], edge_step[e]);
+            }
+
+            __m128 uncovered = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_setzero_si128(), outside));
+            __m128 z = pv[0];
+            __m128 old_depth = _mm_loadu_ps(depth_row + x);
+            __m128 pass = _mm_andnot_ps(uncovered, _mm_cmplt_ps(z, old_depth));
+
+            if (_mm_movemask_ps(pass)) {
+                _mm_storeu_ps(depth_row + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, old_depth)));
+
+                // Same as ps_main: the interpolated normal, square rooted.
+                __m128 w = _mm_div_ps(one, pv[1]);
+                __m128i rgb[3];
+                for (int c = 0; c < 3; ++c) {
+                    __m128 n = _mm_min_ps(_mm_max_ps(_mm_mul_ps(pv[2 + c], w), zero), one);
+                    rgb[c] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(n), scale), round));
+                }
+
+                __m128i packed = _mm_or_si128(_mm_or_si128(rgb[0], _mm_slli_epi32(rgb[1], 8)), _mm_or_si128(_mm_slli_epi32(rgb[2], 16), alpha));
+                __m128i old_color = _mm_loadu_si128((__m128i*)(color_row + x));
+                __m128i pass_i = _mm_castps_si128(pass);
+
+                _mm_storeu_si128((__m128i*)(color_row + x), _mm_or_si128(_mm_and_si128(pass_i, packed), _mm_andnot_si128(pass_i, old_color)));
+            }
+
+            for (int a = 0; a < 5; ++a) {
+                pv[a] = _mm_add_ps(pv[a], plane_step[a]);
+            }
+        }
+    }
+}
+
+static void raster_tiles(void* arg, uint32_t begin, uint32_t end) {
+    Renderer* r = (Renderer*)arg;
+
+    for (uint32_t t = begin; t < end; ++t) {
+        int32_t tile_x = (int32_t)(t % r->tiles_x) * TILE_SIZE;
+        int32_t tile_y = (int32_t)(t / r->tiles_x) * TILE_SIZE;
+
+        __m128i clear_color = _mm_set1_epi32((int)CLEAR_COLOR);
+        __m128 clear_depth = _mm_set1_ps(1.0f);
+
+        for (int32_t y = tile_y; y < tile_y + TILE_SIZE; ++y) {
+            uint32_t* color_row = r->color + (size_t)y * r->pitch + tile_x;
+            float* depth_row = r->depth + (size_t)y * r->pitch + tile_x;
+
+            for (int32_t x = 0; x < TILE_SIZE; x += 4) {
+                _mm_storeu_si128((__m128i*)(color_row + x), clear_color);
+                _mm_storeu_ps(depth_row + x, clear_depth);
+            }
+        }
+
+        int32_t tile_x1 = tile_x + TILE_SIZE - 1;
+        int32_t tile_y1 = tile_y + TILE_SIZE - 1;
+
+        for (uint32_t i = r->tile_starts[t]; i < r->tile_starts[t + 1]; ++i) {
+            SoftTri* tri = r->tile_refs[i];
+
+            int32_t x0 = tri->min_x > tile_x ? tri->min_x : tile_x;
+            int32_t y0 = tri->min_y > tile_y ? tri->min_y : tile_y;
+            int32_t x1 = tri->max_x < tile_x1 ? tri->max_x : tile_x1;
+            int32_t y1 = tri->max_y < tile_y1 ? tri->max_y : tile_y1;
+
+            raster_tri(r, tri, x0 & ~3, y0, x1, y1);
+        }
+    }
+}
+
+void rd_render(Renderer* r) {
+    float start_time = engine_time();
+
+    if (r->work_dirty) {
+        build_work(r);
+    }
+
+    r->camera = camera_matrix(r->fixed_time ? r->time : engine_time(), (float)r->width / (float)r->height);
+
+    parallel_for(r->js, r->chunk_count, 1, transform_chunks, r);
+
+    float transform_done_time = engine_time();
+
+    if (r->tile_counts_cap < r->batch_count) {
+        r->tile_counts_cap = r->batch_count;
+        r->tile_counts = (uint32_t*)realloc(r->tile_counts, (size_t)r->tile_counts_cap * r->tile_count * sizeof(uint32_t));
+    }
+
+    parallel_for(r->js, r->batch_count, 1, setup_batches, r);
+
+    // Tile-major prefix sum, with batches in submission order inside each tile so draw order is kept.
+    uint32_t ref_count = 0;
+    uint32_t visible_count = 0;
+
+    for (uint32_t t = 0; t < r->tile_count; ++t) {
+        r->tile_starts[t] = ref_count;
+
+        for (uint32_t b = 0; b < r->batch_count; ++b) {
+            uint32_t* count = r->tile_counts + b * r->tile_count + t;
+            uint32_t n = *count;
+            *count = ref_count;
+            ref_count += n;
+        }
+    }
+
+    r->tile_starts[r->tile_count] = ref_count;
+
+    for (uint32_t b = 0; b < r->batch_count; ++b) {
+        visible_count += r->batches[b].tri_count;
+    }
+
+    if (r->tile_refs_cap < ref_count) {
+        r->tile_refs_cap = ref_count * 2;
+        r->tile_refs = (SoftTri**)realloc(r->tile_refs, r->tile_refs_cap * sizeof(SoftTri*));
+    }
+
+    parallel_for(r->js, r->batch_count, 1, bin_batches, r);
+
+    float bin_done_time = engine_time();
+
+    parallel_for(r->js, r->tile_count, 1, raster_tiles, r);
+
+    r->stats.visible_triangle_count = visible_count;
+    r->stats.transform_time = transform_done_time - start_time;
+    r->stats.bin_time = bin_done_time - transform_done_time;
+    r->stats.raster_time = engine_time() - bin_done_time;
+}
+
+uint32_t* rd_soft_pixels(Renderer* r, uint32_t* o_width, uint32_t* o_height, uint32_t* o_pitch) {
+    *o_width = r->width;
+    *o_height = r->height;
+    *o_pitch = r->pitch;
+    return r->color;
+}
+
+void rd_soft_set_time(Renderer* r, float time) {
+    r->fixed_time = true;
+    r->time = time;
+}
+
+void rd_soft_stats(Renderer* r, RDSoftStats* o_stats) {
+    *o_stats = r->stats;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "renderer.h"
+#include "jobs.h"
+
+// The software backend renders into memory instead of a window: pass an RDSoftDesc as rd_init's window.
+// rd_render spreads its work over js and must be called from one of its workers.
+struct RDSoftDesc {
+    uint32_t width;
+    uint32_t height;
+    JobSystem* js;
+};
+
+// Timings in seconds for the last rd_render.
+struct RDSoftStats {
+    uint32_t triangle_count;
+    uint32_t visible_triangle_count; // After culling and clipping, so clipped triangles can count more than once.
+    float transform_time;
+    float bin_time;
+    float raster_time;
+};
+
+// RGBA8 pixels of the last frame. Rows are o_pitch pixels apart.
+uint32_t* rd_soft_pixels(Renderer* r, uint32_t* o_width, uint32_t* o_height, uint32_t* o_pitch);
+
+// Pins the animation clock rd_render uses instead of engine_time, for reproducible frames.
+void rd_soft_set_time(Renderer* r, float time);
+
+void rd_soft_stats(Renderer* r, RDSoftStats* o_stats);
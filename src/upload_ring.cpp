@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "upload_ring.h"
+
+struct RingSubmission {
+    uint64_t fence;
+    uint64_t end;
+};
+
+// head and tail count bytes ever allocated and reclaimed, so head - tail is the space in use
+// and head % capacity is where the next allocation goes.
+struct UploadRing {
+    uint64_t capacity;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t submitted;
+
+    RingSubmission* submissions;
+    uint32_t submission_count;
+    uint32_t submission_cap;
+
+    uint64_t peak_used;
+    uint64_t wrap_padding;
+};
+
+UploadRing* upload_ring_create(uint64_t capacity) {
+    assert(capacity > 0);
+
+    UploadRing* ring = (UploadRing*)calloc(1, sizeof(UploadRing));
+    ring->capacity = capacity;
+
+    return ring;
+}
+
+void upload_ring_free(UploadRing* ring) {
+    free(ring->submissions);
+    free(ring);
+}
+
+uint64_t upload_ring_alloc(UploadRing* ring, uint64_t size, uint64_t alignment) {
+    assert(size > 0 && size <= ring->capacity);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= ring->capacity);
+
+    uint64_t offset = ring->head % ring->capacity;
+    uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+    uint64_t start = ring->head + (aligned - offset);
+
+    // Allocations never straddle the end, so a tail that doesn't fit skips to the start. The skip is measured
+    // from the unaligned offset since a capacity that isn't a multiple of alignment can round past the end.
+    uint64_t wrap = 0;
+    if (aligned + size > ring->capacity) {
+        wrap = ring->capacity - offset;
+        start = ring->head + wrap;
+        aligned = 0;
+    }
+
+    if (start + size - ring->tail > ring->capacity) {
+        return UPLOAD_RING_FULL;
+    }
+
+    ring->head = start + size;
+    ring->wrap_padding += wrap;
+
+    if (ring->head - ring->tail > ring->peak_used) {
+        ring->peak_used = ring->head - ring->tail;
+    }
+
+    return aligned;
+}
+
+void upload_ring_submit(UploadRing* ring, uint64_t fence) {
+    if (ring->head == ring->submitted) {
+        return;
+    }
+
+    assert(ring->submission_count == 0 || ring->submissions[ring->submission_count - 1].fence < fence);
+
+    if (ring->submission_count == ring->submission_cap) {
+        ring->submission_cap = ring->submission_cap ? ring->submission_cap * 2 : 16;
+        ring->submissions = (RingSubmission*)realloc(ring->submissions, ring->submission_cap * sizeof(RingSubmission));
+    }
+
+    RingSubmission* s = ring->submissions + ring->submission_count++;
+    s->fence = fence;
+    s->end = ring->head;
+
+    ring->submitted = ring->head;
+}
+
+void upload_ring_retire(UploadRing* ring, uint64_t completed_fence) {
+    uint32_t done = 0;
+
+    while (done < ring->submission_count && ring->submissions[done].fence <= completed_fence) {
+        ring->tail = ring->submissions[done].end;
+        ++done;
+    }
+
+    if (done > 0) {
+        ring->submission_count -= done;
+        memmove(ring->submissions, ring->submissions + done, ring->submission_count * sizeof(RingSubmission));
+    }
+}
+
+uint64_t upload_ring_oldest_fence(UploadRing* ring) {
+    return ring->submission_count > 0 ? ring->submissions[0].fence : 0;
+}
+
+void upload_ring_stats(UploadRing* ring, UploadRingStats* o_stats) {
+    o_stats->capacity = ring->capacity;
+    o_stats->used = ring->head - ring->tail;
+    o_stats->peak_used = ring->peak_used;
+    o_stats->wrap_padding = ring->wrap_padding;
+    o_stats->pending_submissions = ring->submission_count;
+}
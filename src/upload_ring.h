@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+
+// Linear allocator over a ring of transient upload memory, independent of any graphics API.
+// Allocations are tagged in batches with the fence of the submission that reads them, and space comes back
+// in submission order as those fences complete. Offsets are into the backend's mapped buffer.
+
+#define UPLOAD_RING_FULL UINT64_MAX
+
+struct UploadRing;
+
+struct UploadRingStats {
+    uint64_t capacity;
+    uint64_t used; // Bytes allocated and not yet reclaimed, including wrap padding.
+    uint64_t peak_used;
+    uint64_t wrap_padding; // Total bytes skipped at the end of the ring to keep allocations contiguous.
+    uint32_t pending_submissions;
+};
+
+UploadRing* upload_ring_create(uint64_t capacity);
+void upload_ring_free(UploadRing* ring);
+
+// size must fit in the ring, and alignment must be a power of two no larger than it, though the capacity needn't
+// be a multiple of it; bytes skipped at the end count as wrap padding. Returns UPLOAD_RING_FULL
+// if the space isn't free yet; submit, wait on upload_ring_oldest_fence and retire, then try again.
+uint64_t upload_ring_alloc(UploadRing* ring, uint64_t size, uint64_t alignment);
+
+// Everything allocated since the last submit is reclaimed once fence completes. Fences must increase.
+void upload_ring_submit(UploadRing* ring, uint64_t fence);
+void upload_ring_retire(UploadRing* ring, uint64_t completed_fence);
+
+// The fence that frees the most space next, or 0 if nothing submitted is outstanding.
+uint64_t upload_ring_oldest_fence(UploadRing* ring);
+
+void upload_ring_stats(UploadRing* ring, UploadRingStats* o_stats);